@@ -0,0 +1,158 @@
+#include "Allocator.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+static atomic<unsigned long long> statements_recorded(0);
+static atomic<unsigned long long> statement_allocations(0);  // Выделения во время этих операторов
+
+#ifdef SUBBSAD_COUNT_ALLOCATIONS
+// Счётчики свои у каждого потока: фоновые потоки (сохранение, чтение скрипта)
+// не попадают в выделения оператора, который выполняется в этом потоке
+static thread_local unsigned long long allocations = 0;
+static thread_local unsigned long long allocation_bytes = 0;
+
+// Замена глобальных operator new/delete: остальные формы (new[], nothrow)
+// в стандартной библиотеке вызывают эти
+void* operator new(size_t bytes) {
+    ++allocations;
+    allocation_bytes += bytes;
+    void* memory = malloc(bytes ? bytes : 1);
+    if (!memory) {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+bool counting_allocations() {
+    return true;
+}
+
+unsigned long long allocation_count() {
+    return allocations;
+}
+
+unsigned long long allocated_bytes() {
+    return allocation_bytes;
+}
+#else
+bool counting_allocations() {
+    return false;
+}
+
+unsigned long long allocation_count() {
+    return 0;
+}
+
+unsigned long long allocated_bytes() {
+    return 0;
+}
+#endif
+
+void record_statements(size_t statements, unsigned long long allocations) {
+    statements_recorded += statements;
+    statement_allocations += allocations;
+}
+
+void print_allocation_stats() {
+    if (!counting_allocations()) {
+        cout << "Allocation counting is off (build with -DSUBBSAD_COUNT_ALLOCATIONS)";
+        cout << ", statement arena " << statement_arena().capacity() << " bytes" << endl;
+        return;
+    }
+    unsigned long long statements = statements_recorded.load();
+    unsigned long long allocations = statement_allocations.load();
+    cout << "Allocations: " << allocation_count() << " total in this thread, " << allocations << " in " << statements << " statements";
+    if (statements > 0) {
+        cout << " (" << allocations / statements << " per statement)";
+    }
+    cout << ", statement arena " << statement_arena().capacity() << " bytes" << endl;
+}
+
+Arena::Arena() : blocks(nullptr) {}
+
+Arena::~Arena() {
+    while (blocks) {
+        Block* next = blocks->next;
+        ::operator delete(blocks);
+        blocks = next;
+    }
+}
+
+// Смещение в блоке, с которого объект будет выровнен на align
+static size_t aligned_offset(unsigned char* memory, size_t used, size_t align) {
+    size_t address = reinterpret_cast<size_t>(memory) + used;
+    return used + ((align - address % align) % align);
+}
+
+void* Arena::allocate(size_t bytes, size_t align) {
+    if (blocks) {
+        size_t offset = aligned_offset(memory(blocks), blocks->used, align);
+        if (offset + bytes <= blocks->size) {
+            blocks->used = offset + bytes;
+            return memory(blocks) + offset;
+        }
+    }
+    // Новый блок: обычного размера или под один большой объект
+    size_t size = bytes + align > ARENA_BLOCK ? bytes + align : ARENA_BLOCK;
+    Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+    block->next = blocks;
+    block->size = size;
+    blocks = block;
+    size_t offset = aligned_offset(memory(block), 0, align);
+    block->used = offset + bytes;
+    return memory(block) + offset;
+}
+
+void Arena::reset() {
+    // Остаётся один блок обычного размера, остальные возвращаются системе
+    Block* kept = nullptr;
+    while (blocks) {
+        Block* next = blocks->next;
+        if (!kept && blocks->size == ARENA_BLOCK) {
+            kept = blocks;
+            kept->next = nullptr;
+            kept->used = 0;
+        }
+        else {
+            ::operator delete(blocks);
+        }
+        blocks = next;
+    }
+    blocks = kept;
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (Block* block = blocks; block; block = block->next) {
+        total += block->size;
+    }
+    return total;
+}
+
+static thread_local Arena arena;
+static thread_local size_t arena_depth = 0;
+
+Arena& statement_arena() {
+    return arena;
+}
+
+ArenaScope::ArenaScope() {
+    ++arena_depth;
+}
+
+ArenaScope::~ArenaScope() {
+    if (--arena_depth == 0) {
+        arena.reset();
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+using namespace std;
+
+const size_t POOL_SLAB_NODES = 256;  // Узлов в одном блоке пула
+const size_t ARENA_BLOCK = 64 * 1024;  // Размер блока арены запроса
+
+// Счётчик выделений памяти текущего потока. Считает заменённый глобальный operator new,
+// который собирается только с -DSUBBSAD_COUNT_ALLOCATIONS; без флага счётчик всегда 0.
+// Бенчмарки и STATS считают по нему выделения на оператор.
+bool counting_allocations();
+unsigned long long allocation_count();
+unsigned long long allocated_bytes();
+
+// Учёт выделений по выполненным операторам для STATS
+void record_statements(size_t statements, unsigned long long allocations);
+void print_allocation_stats();
+
+// Пул узлов одного размера: память берётся блоками по POOL_SLAB_NODES узлов,
+// освобождённые узлы уходят в список свободных и переиспользуются.
+// Без блокировки: пул защищается тем же, что и его владелец.
+template<typename T>
+class NodePool {
+private:
+    union Slot {
+        Slot* next;  // Следующий свободный узел
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct Slab {
+        Slab* next;
+        Slot slots[POOL_SLAB_NODES];
+    };
+
+    Slab* slabs;
+    Slot* free_list;
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+public:
+    NodePool() : slabs(nullptr), free_list(nullptr) {}
+
+    // Живые узлы должны быть уничтожены владельцем до пула
+    ~NodePool() {
+        while (slabs) {
+            Slab* next = slabs->next;
+            delete slabs;
+            slabs = next;
+        }
+    }
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        if (!free_list) {
+            Slab* slab = new Slab;
+            slab->next = slabs;
+            slabs = slab;
+            for (size_t i = 0; i < POOL_SLAB_NODES; ++i) {
+                slab->slots[i].next = free_list;
+                free_list = &slab->slots[i];
+            }
+        }
+        Slot* slot = free_list;
+        free_list = slot->next;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* node) {
+        node->~T();
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        slot->next = free_list;
+        free_list = slot;
+    }
+};
+
+// Арена для временных данных одного оператора: выделение — сдвиг указателя,
+// освобождение — всё сразу в reset(). Один блок остаётся для следующего оператора.
+class Arena {
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+        size_t used;
+    };
+
+    Block* blocks;  // Текущий блок первым
+
+    static unsigned char* memory(Block* block) {
+        return reinterpret_cast<unsigned char*>(block + 1);
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+public:
+    Arena();
+    ~Arena();
+
+    void* allocate(size_t bytes, size_t align = alignof(max_align_t));
+    void reset();
+    size_t capacity() const;  // Память всех блоков арены
+};
+
+// Арена текущего потока
+Arena& statement_arena();
+
+// Граница оператора: при выходе из самой внешней области арена потока очищается.
+// Вложенные области (соединение внутри оператора) ничего не освобождают.
+class ArenaScope {
+public:
+    ArenaScope();
+    ~ArenaScope();
+};
+
+// Аллокатор для стандартных контейнеров поверх арены потока.
+// deallocate ничего не делает: память вернётся в конце оператора.
+// Контейнер не должен пережить ArenaScope, в котором создан.
+template<typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    ArenaAllocator() {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(statement_arena().allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+#endif
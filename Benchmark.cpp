@@ -0,0 +1,349 @@
+// Набор бенчмарков для всех путей хранения и выполнения запросов.
+// Сборка: g++ -std=c++17 -O2 -DSUBBSAD_NO_MAIN -DSUBBSAD_COUNT_ALLOCATIONS Benchmark.cpp SUBBSAD.cpp HashTable.cpp Persistence.cpp BufferPool.cpp Compression.cpp ZoneMap.cpp Planner.cpp MaterializedView.cpp ResultCache.cpp Allocator.cpp -pthread -o bench
+// Запуск: ./bench [--min-rows N] [--max-rows N] [--reps N] [--out results.json]
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include "SUBBSAD.h"
+#include "Persistence.h"
+#include "BufferPool.h"
+#include "Compression.h"
+#include "Planner.h"
+#include "ResultCache.h"
+#include "Allocator.h"
+#include "nlohmann/json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+// Поток, который выбрасывает весь вывод движка во время замеров
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// Описание одного бенчмарка
+struct BenchCase {
+    string name;
+    size_t max_rows;  // Верхняя граница размера: квадратичные пути ограничены
+    // Подготовка выполняется вне замера, возвращает число операций в замере
+    function<size_t(size_t rows)> setup;
+    function<void(size_t rows)> run;
+    function<void()> teardown;
+};
+
+// Генераторы синтетических строк для схемы U/GU
+CustVector<string> make_u_row(size_t i) {
+    CustVector<string> row;
+    row.push_back(to_string(i));
+    row.push_back("user" + to_string(i));
+    row.push_back("user" + to_string(i) + "@mail.ru");
+    return row;
+}
+
+CustVector<string> make_gu_row(size_t i) {
+    CustVector<string> row;
+    row.push_back(to_string(i));
+    row.push_back("group" + to_string(i % 100));
+    row.push_back("owner" + to_string(i) + "@mail.ru");
+    return row;
+}
+
+CustVector<string> make_columns(const string& c1, const string& c2, const string& c3) {
+    CustVector<string> columns;
+    columns.push_back(c1);
+    columns.push_back(c2);
+    columns.push_back(c3);
+    return columns;
+}
+
+// Регистрирует таблицу с rows сгенерированными строками в глобальной хеш-таблице
+Table* make_table(const string& name, size_t rows) {
+    Table* table = new Table(name);
+    init_storage(*table);
+    table->primary_key = "ID";
+    if (name == "U") {
+        table->columns = make_columns("ID", "NA", "EM");
+        for (size_t i = 0; i < rows; ++i) append_row(*table, make_u_row(i));
+    }
+    else {
+        table->columns = make_columns("ID", "NT", "EE");
+        for (size_t i = 0; i < rows; ++i) append_row(*table, make_gu_row(i));
+    }
+    table->pk_sequence = rows;
+    tables.put(name, reinterpret_cast<void*>(table));
+    return table;
+}
+
+void drop_table(const string& name) {
+    persistence.flush();  // Фоновый поток не должен держать указатель на удаляемую таблицу
+    Table* table = reinterpret_cast<Table*>(tables.get(name));
+    if (table) {
+        tables.remove(name);
+        persistence.forget(table);
+        delete table;
+    }
+}
+
+void drop_all() {
+    drop_table("U");
+    drop_table("GU");
+}
+
+CustVector<string> list(const string& a, const string& b = "") {
+    CustVector<string> result;
+    result.push_back(a);
+    if (!b.empty()) result.push_back(b);
+    return result;
+}
+
+// Состояние, разделяемое между setup и run
+HashTable* bench_hash = nullptr;
+CustVector<CustVector<string>>* bench_rows = nullptr;
+
+void free_bench_state() {
+    delete bench_hash;
+    bench_hash = nullptr;
+    delete bench_rows;
+    bench_rows = nullptr;
+}
+
+CustVector<BenchCase> make_cases() {
+    CustVector<BenchCase> cases;
+    const size_t ops = 100;  // Число операций для путей, стоимость которых растёт с размером таблицы
+
+    cases.push_back({ "hashtable_put", 100000,
+        [](size_t rows) { bench_hash = new HashTable(10); return rows; },
+        [](size_t rows) {
+            for (size_t i = 0; i < rows; ++i) bench_hash->put("key" + to_string(i), reinterpret_cast<void*>(i + 1));
+        },
+        free_bench_state });
+
+    cases.push_back({ "hashtable_get", 100000,
+        [](size_t rows) {
+            bench_hash = new HashTable(10);
+            for (size_t i = 0; i < rows; ++i) bench_hash->put("key" + to_string(i), reinterpret_cast<void*>(i + 1));
+            return rows;
+        },
+        [](size_t rows) {
+            for (size_t i = 0; i < rows; ++i) bench_hash->get("key" + to_string(i));
+        },
+        free_bench_state });
+
+    cases.push_back({ "custvector_growth", 10000000,
+        [](size_t rows) { bench_rows = new CustVector<CustVector<string>>(); return rows; },
+        [](size_t rows) {
+            for (size_t i = 0; i < rows; ++i) bench_rows->push_back(make_u_row(i));
+        },
+        free_bench_state });
+
+    cases.push_back({ "csv_save", 10000000,
+        [](size_t rows) { make_table("U", rows); return rows; },
+        [](size_t) { save_table_csv(*reinterpret_cast<Table*>(tables.get("U"))); },
+        drop_all });
+
+    cases.push_back({ "csv_load", 10000000,
+        [](size_t rows) {
+            save_table_csv(*make_table("U", rows));
+            drop_all();
+            return rows;
+        },
+        [](size_t) { load_table_csv("U"); },
+        drop_all });
+
+    cases.push_back({ "json_save", 10000000,
+        [](size_t rows) { make_table("U", rows); return rows; },
+        [](size_t) { save_table_json(*reinterpret_cast<Table*>(tables.get("U"))); },
+        drop_all });
+
+    cases.push_back({ "json_load", 10000000,
+        [](size_t rows) {
+            save_table_json(*make_table("U", rows));
+            drop_all();
+            return rows;
+        },
+        [](size_t) { load_table_json("U"); },
+        drop_all });
+
+    cases.push_back({ "compressed_save", 10000000,
+        [](size_t rows) { make_table("U", rows); return rows; },
+        [](size_t) { save_table_compressed(*reinterpret_cast<Table*>(tables.get("U"))); },
+        drop_all });
+
+    cases.push_back({ "compressed_load", 10000000,
+        [](size_t rows) {
+            save_table_compressed(*make_table("U", rows));
+            drop_all();
+            return rows;
+        },
+        [](size_t) { load_table("U"); },
+        drop_all });
+
+    cases.push_back({ "insert", 100000,
+        [ops](size_t rows) { make_table("U", rows); return ops; },
+        [ops](size_t) {
+            for (size_t i = 0; i < ops; ++i) insert_data("U", list("name" + to_string(i), "mail" + to_string(i)));
+        },
+        drop_all });
+
+    // INSERT с подтверждением сразу после постановки в очередь и одной записью на диск в конце
+    cases.push_back({ "insert_async", 100000,
+        [ops](size_t rows) { make_table("U", rows); persistence.setDurability(Durability::Async); return ops; },
+        [ops](size_t) {
+            for (size_t i = 0; i < ops; ++i) insert_data("U", list("name" + to_string(i), "mail" + to_string(i)));
+            persistence.flush();
+        },
+        [] { persistence.setDurability(Durability::Sync); drop_all(); } });
+
+    cases.push_back({ "select_point", 10000000,
+        [ops](size_t rows) { make_table("U", rows); return ops; },
+        [ops](size_t rows) {
+            for (size_t i = 0; i < ops; ++i) select_data(list("U"), list("*"), "ID = " + to_string(i * rows / ops));
+        },
+        drop_all });
+
+    // То же после ANALYZE: планировщик выбирает индекс по первичному ключу
+    cases.push_back({ "select_point_indexed", 10000000,
+        [ops](size_t rows) { make_table("U", rows); analyze_table("U"); return ops; },
+        [ops](size_t rows) {
+            for (size_t i = 0; i < ops; ++i) select_data(list("U"), list("*"), "ID = " + to_string(i * rows / ops));
+        },
+        drop_all });
+
+    // Один и тот же запрос к неизменной таблице: все выполнения, кроме первого, берутся из кеша
+    cases.push_back({ "select_repeat", 10000000,
+        [ops](size_t rows) { make_table("U", rows); return ops; },
+        [ops](size_t rows) {
+            for (size_t i = 0; i < ops; ++i) select_data(list("U"), list("*"), "ID < " + to_string(rows / 100));
+        },
+        drop_all });
+
+    cases.push_back({ "select_scan", 10000000,
+        [](size_t rows) { make_table("U", rows); return rows; },
+        [](size_t) { select_data(list("U"), list("*"), "NA != none"); },
+        drop_all });
+
+    // Скан страничной таблицы через буферный пул в 1 МБ
+    cases.push_back({ "select_scan_paged", 10000000,
+        [](size_t rows) { buffer_pool.setMemoryBudget(1024 * 1024); make_table("U", rows); return rows; },
+        [](size_t) { select_data(list("U"), list("*"), "NA != none"); },
+        [] { drop_all(); buffer_pool.setMemoryBudget(0); } });
+
+    // Диапазон ID по одному проценту строк: остальные блоки отсекаются по min/max
+    cases.push_back({ "select_range", 10000000,
+        [](size_t rows) { make_table("U", rows); return rows / 100 + 1; },
+        [](size_t rows) { select_data(list("U"), list("*"), "ID < " + to_string(rows / 100)); },
+        drop_all });
+
+    cases.push_back({ "delete", 100000,
+        [ops](size_t rows) { make_table("U", rows); return ops; },
+        [ops](size_t) {
+            for (size_t i = 0; i < ops; ++i) delete_data("U", "ID = " + to_string(i));
+        },
+        drop_all });
+
+    // Соединение двух таблиц: U из rows строк на GU из 100 строк
+    cases.push_back({ "join", 100000,
+        [](size_t rows) { make_table("U", rows); make_table("GU", 100); return rows * 100; },
+        [](size_t) { select_data(list("U", "GU"), list("NA", "NT")); },
+        drop_all });
+
+    // Соединение по равенству ключей: хеш строится по меньшей таблице
+    cases.push_back({ "join_hash", 10000000,
+        [](size_t rows) { make_table("U", rows); make_table("GU", rows / 10 + 1); return rows; },
+        [](size_t) { select_data(list("U", "GU"), list("NA", "NT"), "ID = GU.ID"); },
+        drop_all });
+
+    return cases;
+}
+
+int main(int argc, char* argv[]) {
+    size_t min_rows = 1000;
+    size_t max_rows = 100000;
+    size_t reps = 3;
+    string out_path = "bench_results.json";
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--min-rows") min_rows = stoull(argv[i + 1]);
+        else if (arg == "--max-rows") max_rows = stoull(argv[i + 1]);
+        else if (arg == "--reps") reps = stoull(argv[i + 1]);
+        else if (arg == "--out") out_path = argv[i + 1];
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+    out_path = fs::absolute(out_path).string();
+
+    // Все файлы таблиц создаются во временном каталоге, чтобы не затирать рабочие данные
+    fs::path work_dir = fs::temp_directory_path() / ("subbsad_bench_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(work_dir);
+    fs::current_path(work_dir);
+
+    NullBuffer null_buffer;
+    streambuf* console = cout.rdbuf();
+
+    json results;
+    results["context"] = {
+        { "min_rows", min_rows },
+        { "max_rows", max_rows },
+        { "repetitions", reps },
+    };
+    results["benchmarks"] = json::array();
+
+    CustVector<BenchCase> cases = make_cases();
+    for (size_t c = 0; c < cases.size; ++c) {
+        const BenchCase& bench = cases[c];
+        for (size_t rows = min_rows; rows <= max_rows && rows <= bench.max_rows; rows *= 10) {
+            double best_ns = 0;
+            double total_ns = 0;
+            size_t ops = 0;
+            unsigned long long hits = result_cache.getHits();
+            unsigned long long misses = result_cache.getMisses();
+            unsigned long long allocations = 0;  // Выделения памяти внутри замеров
+            for (size_t r = 0; r < reps; ++r) {
+                cout.rdbuf(&null_buffer);
+                ops = bench.setup(rows);
+                unsigned long long allocations_before = allocation_count();
+                auto start = chrono::steady_clock::now();
+                bench.run(rows);
+                auto finish = chrono::steady_clock::now();
+                allocations += allocation_count() - allocations_before;
+                bench.teardown();
+                cout.rdbuf(console);
+
+                double ns = chrono::duration<double, nano>(finish - start).count();
+                total_ns += ns;
+                if (r == 0 || ns < best_ns) best_ns = ns;
+            }
+
+            json entry;
+            entry["name"] = bench.name;
+            entry["rows"] = rows;
+            entry["ops"] = ops;
+            entry["best_ms"] = best_ns / 1e6;
+            entry["mean_ms"] = total_ns / reps / 1e6;
+            entry["ns_per_op"] = best_ns / (ops ? ops : 1);
+            entry["cache_hits"] = (result_cache.getHits() - hits) / reps;
+            entry["cache_misses"] = (result_cache.getMisses() - misses) / reps;
+            if (counting_allocations()) {
+                entry["allocs_per_op"] = static_cast<double>(allocations) / reps / (ops ? ops : 1);
+            }
+            results["benchmarks"].push_back(entry);
+            cerr << bench.name << " rows=" << rows << " best=" << best_ns / 1e6 << " ms" << endl;
+        }
+    }
+
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(work_dir);
+
+    ofstream file(out_path);
+    file << results.dump(4);
+    cerr << "Results saved to " << out_path << endl;
+    return 0;
+}
@@ -0,0 +1,551 @@
+#include "BufferPool.h"
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+
+using namespace std;
+
+BufferPool buffer_pool;  // Общий буферный пул для всех страничных таблиц
+
+// Заголовок страницы: число строк и занятые байты
+const size_t PAGE_HEADER = 2 * sizeof(uint32_t);
+
+static uint32_t read_u32(const char* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static void write_u32(char* data, uint32_t value) {
+    memcpy(data, &value, sizeof(value));
+}
+
+PageFile::PageFile(const string& path) : path(path), page_count(0) {
+    file.open(path, ios::in | ios::out | ios::trunc | ios::binary);
+    if (!file.is_open()) {
+        cout << "Failed to open page file " << path << endl;
+    }
+    buffer_pool.registerFile(path);
+}
+
+PageFile::~PageFile() {
+    file.close();
+    error_code error;
+    filesystem::remove(path, error);  // Файл страниц — рабочее хранилище, данные таблицы сохраняются в JSON
+}
+
+void PageFile::read(size_t page_id, char* data, size_t pages) {
+    lock_guard<mutex> guard(io_lock);
+    file.clear();
+    file.seekg(page_id * PAGE_SIZE);
+    file.read(data, pages * PAGE_SIZE);
+}
+
+void PageFile::write(size_t page_id, const char* data) {
+    lock_guard<mutex> guard(io_lock);
+    file.clear();
+    file.seekp(page_id * PAGE_SIZE);
+    file.write(data, PAGE_SIZE);
+}
+
+BufferPool::BufferPool(size_t memory_budget) : frames(nullptr), frame_count(0), clock_hand(0), budget(0) {
+    setMemoryBudget(memory_budget);
+}
+
+BufferPool::~BufferPool() {
+    for (size_t i = 0; i < frame_count; ++i) {
+        delete[] frames[i].data;
+    }
+    delete[] frames;
+    // Таблицы не удаляются при выходе, поэтому их файлы страниц убираем здесь
+    for (size_t i = 0; i < page_files.size; ++i) {
+        error_code error;
+        filesystem::remove(page_files[i], error);
+    }
+}
+
+void BufferPool::setMemoryBudget(size_t bytes) {
+    unique_lock<mutex> guard(pool_lock);
+    // Меняем размер только между командами, когда ни одна страница не закреплена
+    for (size_t i = 0; i < frame_count; ++i) {
+        while (frames[i].io) {
+            frames[i].io_done.wait(guard);
+        }
+        if (frames[i].file) {
+            evict(i, guard);
+        }
+        delete[] frames[i].data;
+    }
+    delete[] frames;
+
+    budget = bytes;
+    // Даже без лимита нужны кадры для уже созданных страничных таблиц
+    frame_count = max(MIN_FRAMES, bytes / PAGE_SIZE);
+    frames = new Frame[frame_count];
+    for (size_t i = 0; i < frame_count; ++i) {
+        frames[i].file = nullptr;
+        frames[i].page_id = 0;
+        frames[i].data = nullptr;
+        frames[i].pin_count = 0;
+        frames[i].dirty = false;
+        frames[i].referenced = false;
+        frames[i].io = false;
+    }
+    clock_hand = 0;
+}
+
+size_t BufferPool::getMemoryBudget() {
+    lock_guard<mutex> guard(pool_lock);
+    return budget;
+}
+
+bool BufferPool::enabled() {
+    return getMemoryBudget() > 0;
+}
+
+void BufferPool::evict(size_t frame, unique_lock<mutex>& guard) {
+    Frame& victim = frames[frame];
+    victim.io = true;  // Курсоры, которым нужна эта страница, ждут конца записи
+    if (victim.dirty) {
+        victim.dirty = false;
+        guard.unlock();
+        victim.file->write(victim.page_id, victim.data);
+        guard.lock();
+    }
+    victim.file->frame_of_page[victim.page_id] = 0;
+    victim.file = nullptr;
+    victim.referenced = false;
+    victim.io_done.notify_all();  // Ждавшие страницу прочитают её заново
+}
+
+void BufferPool::finish_io(size_t frame) {
+    frames[frame].io = false;
+    frames[frame].io_done.notify_all();
+    unpinned.notify_all();  // Кадр снова может стать жертвой
+}
+
+size_t BufferPool::find_victim(unique_lock<mutex>& guard, bool wait) {
+    while (true) {
+        // Два оборота часов: на первом снимаются биты обращения
+        for (size_t step = 0; step < 2 * frame_count; ++step) {
+            size_t frame = clock_hand;
+            clock_hand = (clock_hand + 1) % frame_count;
+            Frame& candidate = frames[frame];
+            if (candidate.io || candidate.pin_count > 0) {
+                continue;
+            }
+            if (!candidate.file) {
+                candidate.io = true;
+                return frame;
+            }
+            if (candidate.referenced) {
+                candidate.referenced = false;
+                continue;
+            }
+            evict(frame, guard);
+            return frame;
+        }
+        if (!wait) {
+            return string::npos;
+        }
+        unpinned.wait(guard);  // Все кадры закреплены — ждём, пока другой курсор отпустит страницу
+    }
+}
+
+char* BufferPool::pin(PageFile* file, size_t page_id) {
+    unique_lock<mutex> guard(pool_lock);
+    while (true) {
+        size_t mapped = file->frame_of_page[page_id];
+        if (mapped != 0) {
+            Frame& frame = frames[mapped - 1];
+            if (frame.io) {
+                frame.io_done.wait(guard);  // Страницу читает или записывает другой поток
+                continue;
+            }
+            ++frame.pin_count;
+            frame.referenced = true;
+            return frame.data;
+        }
+
+        size_t frame = find_victim(guard);
+        if (file->frame_of_page[page_id] != 0) {
+            finish_io(frame);  // Пока освобождали кадр, страницу загрузил другой поток
+            continue;
+        }
+        Frame& target = frames[frame];
+        if (!target.data) {
+            target.data = new char[PAGE_SIZE];
+        }
+        target.file = file;
+        target.page_id = page_id;
+        target.pin_count = 1;
+        target.dirty = false;
+        target.referenced = true;
+        file->frame_of_page[page_id] = frame + 1;
+
+        // Чтение без блокировки пула: другие курсоры работают со своими страницами
+        guard.unlock();
+        file->read(page_id, target.data);
+        guard.lock();
+        finish_io(frame);
+        return target.data;
+    }
+}
+
+char* BufferPool::pinNew(PageFile* file, size_t& page_id) {
+    unique_lock<mutex> guard(pool_lock);
+    size_t frame = find_victim(guard);
+    page_id = file->page_count++;
+    file->frame_of_page.push_back(frame + 1);
+
+    Frame& target = frames[frame];
+    if (!target.data) {
+        target.data = new char[PAGE_SIZE];
+    }
+    memset(target.data, 0, PAGE_SIZE);
+    target.file = file;
+    target.page_id = page_id;
+    target.pin_count = 1;
+    target.dirty = true;  // Страницы ещё нет на диске
+    target.referenced = true;
+    finish_io(frame);
+    return target.data;
+}
+
+void BufferPool::unpin(PageFile* file, size_t page_id, bool dirty) {
+    {
+        lock_guard<mutex> guard(pool_lock);
+        Frame& frame = frames[file->frame_of_page[page_id] - 1];
+        frame.dirty = frame.dirty || dirty;
+        --frame.pin_count;
+        if (frame.pin_count > 0) return;
+    }
+    unpinned.notify_all();
+}
+
+void BufferPool::prefetch(PageFile* file, size_t first_page, size_t count) {
+    unique_lock<mutex> guard(pool_lock);
+    // Читаем одним запросом подряд идущие страницы, которых ещё нет в пуле,
+    // но не больше половины пула, чтобы не вытеснить рабочий набор.
+    // Кадры берутся без ожидания: упреждение не должно задерживать другие курсоры.
+    count = min(count, frame_count / 2);
+    CustVector<size_t> targets;
+    CustVector<char*> pages;  // Память кадров targets
+    while (targets.size < count && first_page + targets.size < file->page_count && file->frame_of_page[first_page + targets.size] == 0) {
+        size_t frame = find_victim(guard, false);
+        if (frame == string::npos) break;
+        size_t page = first_page + targets.size;
+        if (file->frame_of_page[page] != 0) {
+            finish_io(frame);
+            break;
+        }
+        Frame& target = frames[frame];
+        if (!target.data) {
+            target.data = new char[PAGE_SIZE];
+        }
+        target.file = file;
+        target.page_id = page;
+        target.pin_count = 0;
+        target.dirty = false;
+        target.referenced = false;  // Непрочитанная страница вытесняется первой
+        file->frame_of_page[page] = frame + 1;
+        targets.push_back(frame);
+        pages.push_back(target.data);
+    }
+    if (targets.size == 0) return;
+
+    // Кадры помечены io, поэтому их не вытеснят и не прочитают повторно, пока пул разблокирован
+    guard.unlock();
+    char* buffer = new char[targets.size * PAGE_SIZE];
+    file->read(first_page, buffer, targets.size);
+    for (size_t i = 0; i < targets.size; ++i) {
+        memcpy(pages[i], buffer + i * PAGE_SIZE, PAGE_SIZE);
+    }
+    delete[] buffer;
+    guard.lock();
+    for (size_t i = 0; i < targets.size; ++i) {
+        finish_io(targets[i]);
+    }
+}
+
+void BufferPool::registerFile(const string& path) {
+    lock_guard<mutex> guard(pool_lock);
+    page_files.push_back(path);
+}
+
+void BufferPool::dropFile(PageFile* file) {
+    unique_lock<mutex> guard(pool_lock);
+    for (size_t i = 0; i < frame_count; ++i) {
+        while (frames[i].file == file && frames[i].io) {
+            frames[i].io_done.wait(guard);  // Запись вытесняемой страницы ещё обращается к файлу
+        }
+        if (frames[i].file == file) {
+            frames[i].file = nullptr;
+            frames[i].dirty = false;
+            frames[i].pin_count = 0;
+        }
+    }
+    // Файл удаляет сам PageFile, при завершении программы убирать его уже не нужно
+    for (size_t i = 0; i < page_files.size; ++i) {
+        if (page_files[i] == file->path) {
+            page_files[i] = page_files[page_files.size - 1];
+            --page_files.size;
+            break;
+        }
+    }
+}
+
+PagedRows::PagedRows(const string& table_name) : file(table_name + "." + to_string(next_file_id++) + ".pages") {}
+
+atomic<size_t> PagedRows::next_file_id(0);
+
+PagedRows::~PagedRows() {
+    buffer_pool.dropFile(&file);
+}
+
+bool PagedRows::append(const CustVector<string>& row) {
+    size_t row_bytes = sizeof(uint32_t);
+    for (size_t i = 0; i < row.size; ++i) {
+        row_bytes += sizeof(uint32_t) + row[i].size();
+    }
+    if (row_bytes > PAGE_SIZE - PAGE_HEADER) {
+        cout << "Row is too large for a page." << endl;
+        return false;
+    }
+
+    lock_guard<mutex> guard(directory_lock);
+    size_t page_id = page_rows.size;
+    char* page = nullptr;
+    if (page_rows.size > 0) {
+        page_id = page_rows.size - 1;
+        page = buffer_pool.pin(&file, page_id);
+        if (read_u32(page + sizeof(uint32_t)) + row_bytes > PAGE_SIZE) {
+            buffer_pool.unpin(&file, page_id, false);
+            page = nullptr;
+        }
+    }
+    if (!page) {
+        page = buffer_pool.pinNew(&file, page_id);
+        write_u32(page + sizeof(uint32_t), PAGE_HEADER);
+        page_rows.push_back(0);
+    }
+
+    // Строка: число значений, затем длина и байты каждого значения
+    size_t offset = read_u32(page + sizeof(uint32_t));
+    write_u32(page + offset, static_cast<uint32_t>(row.size));
+    offset += sizeof(uint32_t);
+    for (size_t i = 0; i < row.size; ++i) {
+        write_u32(page + offset, static_cast<uint32_t>(row[i].size()));
+        offset += sizeof(uint32_t);
+        memcpy(page + offset, row[i].data(), row[i].size());
+        offset += row[i].size();
+    }
+    write_u32(page, read_u32(page) + 1);
+    write_u32(page + sizeof(uint32_t), static_cast<uint32_t>(offset));
+    buffer_pool.unpin(&file, page_id, true);
+
+    ++page_rows[page_id];
+    return true;
+}
+
+size_t PagedRows::rowsOnPage(size_t page_id) {
+    lock_guard<mutex> guard(directory_lock);
+    return page_rows[page_id];
+}
+
+PageFile* PagedRows::pageFile() {
+    return &file;
+}
+
+MemoryRows::~MemoryRows() {
+    for (size_t i = 0; i < chunks.size; ++i) {
+        delete[] chunks[i];
+    }
+}
+
+void MemoryRows::append(const CustVector<string>& row, size_t position) {
+    if (position % CHUNK_ROWS == 0 && position / CHUNK_ROWS == chunks.size) {
+        lock_guard<mutex> guard(directory_lock);
+        chunks.push_back(new CustVector<string>[CHUNK_ROWS]);
+    }
+    // Строка position не видна ни одной копии таблицы, пока вставка не завершится
+    chunks[position / CHUNK_ROWS][position % CHUNK_ROWS] = row;
+}
+
+void MemoryRows::append(CustVector<string>&& row, size_t position) {
+    if (position % CHUNK_ROWS == 0 && position / CHUNK_ROWS == chunks.size) {
+        lock_guard<mutex> guard(directory_lock);
+        chunks.push_back(new CustVector<string>[CHUNK_ROWS]);
+    }
+    chunks[position / CHUNK_ROWS][position % CHUNK_ROWS] = std::move(row);
+}
+
+const CustVector<string>* MemoryRows::chunk(size_t chunk_id) {
+    lock_guard<mutex> guard(directory_lock);
+    return chunks[chunk_id];
+}
+
+RowCursor::RowCursor(const Table& table)
+    : table(table), store(table.paged), memory(table.rows), chunk(nullptr), chunk_id(0), position(0), limit(row_count(table)), current(nullptr),
+    page_id(0), next_page(0), page(nullptr), page_rows(0), page_row(0), offset(0), filter_column(string::npos) {}
+
+RowCursor::~RowCursor() {
+    release();
+}
+
+void RowCursor::release() {
+    if (page) {
+        buffer_pool.unpin(store->pageFile(), page_id, false);
+        page = nullptr;
+    }
+}
+
+// Переход на следующую страницу: отпускаем текущую и читаем следующие с упреждением
+void RowCursor::load_page() {
+    release();
+    page_id = next_page++;
+    page = buffer_pool.pin(store->pageFile(), page_id);
+    buffer_pool.prefetch(store->pageFile(), page_id + 1, PREFETCH_PAGES);
+    page_rows = store->rowsOnPage(page_id);
+    page_row = 0;
+    offset = PAGE_HEADER;
+}
+
+// Пропуск строк без разбора; страницы, пропускаемые целиком, не читаются с диска
+void RowCursor::skip(size_t rows) {
+    size_t target = min(limit, position + rows);
+    if (!store) {
+        position = target;
+        return;
+    }
+    while (position < target) {
+        if (page && page_row < page_rows) {
+            size_t values = read_u32(page + offset);
+            offset += sizeof(uint32_t);
+            for (size_t i = 0; i < values; ++i) {
+                offset += sizeof(uint32_t) + read_u32(page + offset);
+            }
+            ++page_row;
+            ++position;
+        }
+        else if (page) {
+            release();
+        }
+        else {
+            size_t rows_on_page = store->rowsOnPage(next_page);
+            if (position + rows_on_page <= target) {
+                position += rows_on_page;
+                ++next_page;
+            }
+            else {
+                load_page();
+            }
+        }
+    }
+}
+
+void RowCursor::filter(size_t column, const string& op, const string& value) {
+    filter_column = column;
+    filter_op = op;
+    filter_value = value;
+}
+
+void RowCursor::seek(size_t row) {
+    if (row > position) {
+        skip(row - position);
+    }
+}
+
+bool RowCursor::next() {
+    // В начале каждого блока проверяем его статистику и пропускаем блоки, где условие не выполнится
+    while (filter_column != string::npos && position < limit && position % ZONE_ROWS == 0) {
+        size_t block = position / ZONE_ROWS;
+        if (block >= table.zones.size || zone_may_match(table.zones[block], filter_column, filter_op, filter_value)) {
+            break;
+        }
+        skip(ZONE_ROWS);
+    }
+    if (position >= limit) {
+        release();
+        return false;
+    }
+    if (!store) {
+        if (!chunk || position / CHUNK_ROWS != chunk_id) {
+            chunk_id = position / CHUNK_ROWS;
+            chunk = memory->chunk(chunk_id);
+        }
+        current = &chunk[position % CHUNK_ROWS];
+        ++position;
+        return true;
+    }
+
+    if (!page || page_row == page_rows) {
+        load_page();
+    }
+
+    size_t values = read_u32(page + offset);
+    offset += sizeof(uint32_t);
+    buffer.size = 0;  // Переиспользуем выделенную память строки
+    for (size_t i = 0; i < values; ++i) {
+        size_t length = read_u32(page + offset);
+        offset += sizeof(uint32_t);
+        buffer.push_back(string(page + offset, length));
+        offset += length;
+    }
+    ++page_row;
+    ++position;
+    current = &buffer;
+    return true;
+}
+
+const CustVector<string>& RowCursor::row() const {
+    return *current;
+}
+
+void init_storage(Table& table) {
+    if (buffer_pool.enabled()) {
+        table.paged = make_shared<PagedRows>(table.name);
+    }
+    else {
+        table.paged = nullptr;
+    }
+    table.visible_rows = 0;
+    table.rows = nullptr;
+    table.zones = CustVector<ZoneBlock>();
+}
+
+size_t row_count(const Table& table) {
+    return table.visible_rows;
+}
+
+bool append_row(Table& table, const CustVector<string>& row, bool update_zones) {
+    if (!table.paged) {
+        if (!table.rows) {
+            table.rows = make_shared<MemoryRows>();
+        }
+        table.rows->append(row, table.visible_rows);
+    }
+    else if (!table.paged->append(row)) {
+        return false;
+    }
+    ++table.visible_rows;
+    if (update_zones) {
+        zone_add_row(table.zones, row);
+    }
+    return true;
+}
+
+bool append_row(Table& table, CustVector<string>&& row, bool update_zones) {
+    if (table.paged) {
+        return append_row(table, static_cast<const CustVector<string>&>(row), update_zones);  // Страница хранит сериализованную копию
+    }
+    if (update_zones) {
+        zone_add_row(table.zones, row);  // До переноса, пока строка ещё у нас
+    }
+    if (!table.rows) {
+        table.rows = make_shared<MemoryRows>();
+    }
+    table.rows->append(std::move(row), table.visible_rows);
+    ++table.visible_rows;
+    return true;
+}
@@ -0,0 +1,157 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
+#include "SUBBSAD.h"
+using namespace std;
+
+const size_t PAGE_SIZE = 16384;  // Размер страницы на диске и в буферном пуле
+const size_t MIN_FRAMES = 8;  // Минимум кадров: курсоры соединения и вставка держат по странице
+const size_t PREFETCH_PAGES = 8;  // Сколько страниц вперёд читает последовательный скан
+const size_t CHUNK_ROWS = 1024;  // Строк в одном блоке хранилища в памяти
+
+// Файл страниц фиксированного размера
+class PageFile {
+public:
+    string path;
+    fstream file;
+    size_t page_count;
+    CustVector<size_t> frame_of_page;  // Номер кадра + 1 для страниц в пуле, 0 — страница на диске
+    mutex io_lock;  // Чтение и запись идут без блокировки пула, поток файла защищается отдельно
+
+    PageFile(const string& path);
+    ~PageFile();
+
+    void read(size_t page_id, char* data, size_t pages = 1);
+    void write(size_t page_id, const char* data);
+};
+
+// Буферный пул с ограниченным объёмом памяти и вытеснением по алгоритму часов
+class BufferPool {
+private:
+    struct Frame {
+        PageFile* file;
+        size_t page_id;
+        char* data;
+        int pin_count;
+        bool dirty;
+        bool referenced;  // Бит обращения для алгоритма часов
+        bool io;  // Кадр занят чтением или записью на диск, ждать на io_done
+        condition_variable io_done;
+    };
+
+    Frame* frames;
+    size_t frame_count;
+    size_t clock_hand;
+    size_t budget;  // Лимит памяти в байтах, 0 — без ограничения
+    CustVector<string> page_files;  // Файлы страниц, удаляемые при завершении программы
+    mutex pool_lock;
+    condition_variable unpinned;
+
+    // Свободный или вытесняемый кадр, помеченный io для вызывающего. Ждёт, если все закреплены,
+    // или возвращает npos при wait = false
+    size_t find_victim(unique_lock<mutex>& guard, bool wait = true);
+    void evict(size_t frame, unique_lock<mutex>& guard);  // Запись грязной страницы идёт без блокировки пула
+    void finish_io(size_t frame);
+
+public:
+    BufferPool(size_t memory_budget = 0);
+    ~BufferPool();
+
+    void setMemoryBudget(size_t bytes);  // 0 — без ограничения, таблицы хранятся в памяти целиком
+    size_t getMemoryBudget();
+    bool enabled();
+
+    char* pin(PageFile* file, size_t page_id);  // Страница остаётся в памяти до unpin
+    char* pinNew(PageFile* file, size_t& page_id);  // Новая пустая страница в конце файла
+    void unpin(PageFile* file, size_t page_id, bool dirty);
+    void prefetch(PageFile* file, size_t first_page, size_t count);  // Упреждающее чтение для сканов
+    void registerFile(const string& path);
+    void dropFile(PageFile* file);  // Забыть кадры и имя файла без записи на диск
+};
+
+extern BufferPool buffer_pool;
+
+// Строки таблицы в страницах на диске. Только добавление: DELETE строит новое хранилище.
+class PagedRows {
+private:
+    PageFile file;
+    CustVector<size_t> page_rows;  // Число строк на каждой странице
+    mutex directory_lock;  // Защищает page_rows от курсоров снимков во время вставки
+    static atomic<size_t> next_file_id;
+
+public:
+    PagedRows(const string& table_name);
+    ~PagedRows();
+
+    bool append(const CustVector<string>& row);
+    size_t rowsOnPage(size_t page_id);
+    PageFile* pageFile();
+};
+
+// Строки таблицы в памяти блоками по CHUNK_ROWS. Блоки не перемещаются при росте,
+// поэтому копия таблицы разделяет хранилище и читает свои строки, пока в конец дописываются новые.
+// Только добавление: DELETE строит новое хранилище, как и для страниц.
+class MemoryRows {
+private:
+    CustVector<CustVector<string>*> chunks;
+    mutex directory_lock;  // Защищает chunks от курсоров копий во время вставки
+
+public:
+    MemoryRows() {}
+    ~MemoryRows();
+
+    void append(const CustVector<string>& row, size_t position);  // position — число строк до вставки
+    void append(CustVector<string>&& row, size_t position);
+    const CustVector<string>* chunk(size_t chunk_id);
+};
+
+// Курсор по строкам таблицы, одинаковый для таблиц в памяти и в страницах.
+// Для страничной таблицы текущая страница закреплена в пуле, пока курсор на ней.
+class RowCursor {
+private:
+    const Table& table;
+    shared_ptr<PagedRows> store;  // Держит хранилище, даже если DELETE заменит его в таблице
+    shared_ptr<MemoryRows> memory;
+    const CustVector<string>* chunk;  // Текущий блок строк в памяти
+    size_t chunk_id;
+    size_t position;
+    size_t limit;  // Число строк, видимых снимку таблицы
+    const CustVector<string>* current;
+    CustVector<string> buffer;  // Разобранная строка страничной таблицы
+    size_t page_id;
+    size_t next_page;
+    char* page;
+    size_t page_rows;  // Число строк на текущей странице
+    size_t page_row;
+    size_t offset;
+    size_t filter_column;  // Столбец условия для пропуска блоков по статистике, npos — без условия
+    string filter_op;
+    string filter_value;
+
+    void release();
+    void load_page();
+    void skip(size_t rows);
+
+public:
+    RowCursor(const Table& table);
+    ~RowCursor();
+
+    void filter(size_t column, const string& op, const string& value);  // Пропускать блоки, где условие заведомо ложно
+    void seek(size_t row);  // Переход к строке с номером row, только вперёд
+    bool next();
+    const CustVector<string>& row() const;
+};
+
+void init_storage(Table& table);  // Страничное хранилище, если задан лимит памяти
+size_t row_count(const Table& table);
+// update_zones = false, если статистика блока уже прочитана из файла
+bool append_row(Table& table, const CustVector<string>& row, bool update_zones = true);
+bool append_row(Table& table, CustVector<string>&& row, bool update_zones = true);  // Строка в памяти переносится без копирования
+
+#endif
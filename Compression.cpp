@@ -0,0 +1,511 @@
+#include "Compression.h"
+#include "BufferPool.h"
+#include "ZoneMap.h"
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+using namespace std;
+
+atomic<bool> compress_tables(true);
+
+// Статистика столбцов (ZoneMap) хранится в начале каждого блока
+static const char TABLE_MAGIC[4] = { 'S', 'B', 'T', '2' };
+
+// Целые без знака переменной длины: по 7 бит в байте
+static void put_varint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static bool get_varint(const string& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static void put_string(string& out, const string& value) {
+    put_varint(out, value.size());
+    out += value;
+}
+
+static bool get_string(const string& in, size_t& pos, string& value) {
+    uint64_t length;
+    if (!get_varint(in, pos, length) || length > in.size() - pos) return false;
+    value.assign(in, pos, length);
+    pos += length;
+    return true;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+static unsigned bit_width(uint64_t value) {
+    unsigned width = 0;
+    while (value) {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+// Упаковка значений фиксированной ширины, младшие биты первыми
+static void put_packed(string& out, const CustVector<uint64_t>& values, unsigned width) {
+    out.push_back(static_cast<char>(width));
+    if (width == 0) return;
+    uint64_t buffer = 0;
+    unsigned filled = 0;
+    for (size_t i = 0; i < values.size; ++i) {
+        uint64_t value = values[i];
+        unsigned left = width;
+        while (left > 0) {
+            unsigned take = min(left, 64 - filled);
+            uint64_t part = take == 64 ? value : value & ((uint64_t(1) << take) - 1);
+            buffer |= part << filled;
+            filled += take;
+            value = take == 64 ? 0 : value >> take;
+            left -= take;
+            if (filled == 64) {
+                for (int b = 0; b < 8; ++b) out.push_back(static_cast<char>(buffer >> (8 * b)));
+                buffer = 0;
+                filled = 0;
+            }
+        }
+    }
+    for (unsigned b = 0; b * 8 < filled; ++b) out.push_back(static_cast<char>(buffer >> (8 * b)));
+}
+
+static bool get_packed(const string& in, size_t& pos, size_t count, CustVector<uint64_t>& values) {
+    if (pos >= in.size()) return false;
+    unsigned width = static_cast<uint8_t>(in[pos++]);
+    if (width > 64) return false;
+    values.size = 0;
+    if (width == 0) {
+        for (size_t i = 0; i < count; ++i) values.push_back(0);
+        return true;
+    }
+    size_t bytes = (count * width + 7) / 8;
+    if (bytes > in.size() - pos) return false;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(in.data() + pos);
+    size_t bit = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t value = 0;
+        for (unsigned got = 0; got < width;) {
+            unsigned take = min(width - got, 8 - static_cast<unsigned>(bit % 8));
+            uint64_t part = (data[bit / 8] >> (bit % 8)) & ((1u << take) - 1);
+            value |= part << got;
+            got += take;
+            bit += take;
+        }
+        values.push_back(value);
+    }
+    pos += bytes;
+    return true;
+}
+
+// Каноническая запись неотрицательного целого: to_string(число) даёт ту же строку
+static bool parse_canonical(const string& value, uint64_t& number) {
+    if (value.empty() || value.size() > 18) return false;
+    if (value.size() > 1 && value[0] == '0') return false;
+    number = 0;
+    for (char ch : value) {
+        if (ch < '0' || ch > '9') return false;
+        number = number * 10 + (ch - '0');
+    }
+    return true;
+}
+
+static string encode_plain(const CustVector<string>& values) {
+    string out;
+    for (size_t i = 0; i < values.size; ++i) {
+        put_string(out, values[i]);
+    }
+    return out;
+}
+
+// Словарные кодировки имеют смысл, только если различных значений не больше половины блока
+static bool build_dictionary(const CustVector<string>& values, CustVector<string>& dictionary, CustVector<uint64_t>& indices) {
+    unordered_map<string, uint64_t> positions;
+    for (size_t i = 0; i < values.size; ++i) {
+        auto found = positions.find(values[i]);
+        if (found == positions.end()) {
+            if (dictionary.size >= values.size / 2) return false;
+            found = positions.emplace(values[i], dictionary.size).first;
+            dictionary.push_back(values[i]);
+        }
+        indices.push_back(found->second);
+    }
+    return true;
+}
+
+static string encode_dictionary_header(const CustVector<string>& dictionary) {
+    string out;
+    put_varint(out, dictionary.size);
+    for (size_t i = 0; i < dictionary.size; ++i) {
+        put_string(out, dictionary[i]);
+    }
+    return out;
+}
+
+static string encode_dict_rle(const CustVector<string>& dictionary, const CustVector<uint64_t>& indices) {
+    string out = encode_dictionary_header(dictionary);
+    for (size_t i = 0; i < indices.size;) {
+        size_t run = 1;
+        while (i + run < indices.size && indices[i + run] == indices[i]) ++run;
+        put_varint(out, run);
+        put_varint(out, indices[i]);
+        i += run;
+    }
+    return out;
+}
+
+static string encode_dict_packed(const CustVector<string>& dictionary, const CustVector<uint64_t>& indices) {
+    string out = encode_dictionary_header(dictionary);
+    put_packed(out, indices, bit_width(dictionary.size - 1));
+    return out;
+}
+
+static string encode_int_for(const CustVector<uint64_t>& numbers) {
+    uint64_t low = numbers[0];
+    uint64_t high = numbers[0];
+    for (size_t i = 1; i < numbers.size; ++i) {
+        low = min(low, numbers[i]);
+        high = max(high, numbers[i]);
+    }
+    CustVector<uint64_t> offsets;
+    for (size_t i = 0; i < numbers.size; ++i) offsets.push_back(numbers[i] - low);
+    string out;
+    put_varint(out, low);
+    put_packed(out, offsets, bit_width(high - low));
+    return out;
+}
+
+static string encode_int_delta(const CustVector<uint64_t>& numbers) {
+    int64_t low = 0;
+    int64_t high = 0;
+    for (size_t i = 1; i < numbers.size; ++i) {
+        int64_t delta = static_cast<int64_t>(numbers[i] - numbers[i - 1]);
+        if (i == 1 || delta < low) low = delta;
+        if (i == 1 || delta > high) high = delta;
+    }
+    CustVector<uint64_t> offsets;
+    for (size_t i = 1; i < numbers.size; ++i) {
+        offsets.push_back(static_cast<uint64_t>(static_cast<int64_t>(numbers[i] - numbers[i - 1]) - low));
+    }
+    string out;
+    put_varint(out, numbers[0]);
+    put_varint(out, zigzag(low));
+    put_packed(out, offsets, bit_width(static_cast<uint64_t>(high - low)));
+    return out;
+}
+
+// Кодирует блок столбца всеми подходящими способами и оставляет самый короткий
+static void encode_column(const CustVector<string>& values, string& out) {
+    ColumnEncoding best_encoding = ENC_PLAIN;
+    string best = encode_plain(values);
+
+    auto consider = [&](ColumnEncoding encoding, string candidate) {
+        if (candidate.size() < best.size()) {
+            best_encoding = encoding;
+            best = move(candidate);
+        }
+    };
+
+    CustVector<string> dictionary;
+    CustVector<uint64_t> indices;
+    if (build_dictionary(values, dictionary, indices)) {
+        consider(ENC_DICT_RLE, encode_dict_rle(dictionary, indices));
+        consider(ENC_DICT_PACKED, encode_dict_packed(dictionary, indices));
+    }
+
+    CustVector<uint64_t> numbers;
+    bool integers = true;
+    for (size_t i = 0; i < values.size && integers; ++i) {
+        uint64_t number;
+        integers = parse_canonical(values[i], number);
+        if (integers) numbers.push_back(number);
+    }
+    if (integers) {
+        consider(ENC_INT_FOR, encode_int_for(numbers));
+        consider(ENC_INT_DELTA, encode_int_delta(numbers));
+    }
+
+    out.push_back(static_cast<char>(best_encoding));
+    put_varint(out, best.size());
+    out += best;
+}
+
+static bool decode_dictionary(const string& in, size_t& pos, CustVector<string>& dictionary) {
+    uint64_t size;
+    if (!get_varint(in, pos, size)) return false;
+    for (uint64_t i = 0; i < size; ++i) {
+        string entry;
+        if (!get_string(in, pos, entry)) return false;
+        dictionary.push_back(entry);
+    }
+    return true;
+}
+
+// Разбирает блок столбца сразу в значения для строк блока
+static bool decode_column(const string& in, size_t& pos, size_t rows, CustVector<string>& values) {
+    if (pos >= in.size()) return false;
+    ColumnEncoding encoding = static_cast<ColumnEncoding>(in[pos++]);
+    uint64_t length;
+    if (!get_varint(in, pos, length) || length > in.size() - pos) return false;
+    string payload = in.substr(pos, length);
+    pos += length;
+
+    size_t at = 0;
+    values.size = 0;
+    CustVector<string> dictionary;
+    CustVector<uint64_t> numbers;
+    switch (encoding) {
+    case ENC_PLAIN:
+        for (size_t i = 0; i < rows; ++i) {
+            string value;
+            if (!get_string(payload, at, value)) return false;
+            values.push_back(value);
+        }
+        return true;
+    case ENC_DICT_RLE:
+        if (!decode_dictionary(payload, at, dictionary)) return false;
+        while (values.size < rows) {
+            uint64_t run, index;
+            if (!get_varint(payload, at, run) || !get_varint(payload, at, index) || index >= dictionary.size) return false;
+            for (uint64_t i = 0; i < run && values.size < rows; ++i) values.push_back(dictionary[index]);
+        }
+        return true;
+    case ENC_DICT_PACKED:
+        if (!decode_dictionary(payload, at, dictionary) || !get_packed(payload, at, rows, numbers)) return false;
+        for (size_t i = 0; i < rows; ++i) {
+            if (numbers[i] >= dictionary.size) return false;
+            values.push_back(dictionary[numbers[i]]);
+        }
+        return true;
+    case ENC_INT_FOR: {
+        uint64_t low;
+        if (!get_varint(payload, at, low) || !get_packed(payload, at, rows, numbers)) return false;
+        for (size_t i = 0; i < rows; ++i) values.push_back(to_string(low + numbers[i]));
+        return true;
+    }
+    case ENC_INT_DELTA: {
+        uint64_t first, low;
+        if (!get_varint(payload, at, first) || !get_varint(payload, at, low) || !get_packed(payload, at, rows - 1, numbers)) return false;
+        uint64_t current = first;
+        values.push_back(to_string(current));
+        for (size_t i = 0; i + 1 < rows; ++i) {
+            current += numbers[i] + static_cast<uint64_t>(unzigzag(low));
+            values.push_back(to_string(current));
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+static void put_zone(string& out, const ColumnZone& zone) {
+    put_varint(out, zone.values);
+    put_varint(out, zone.nulls);
+    if (zone.values > 0) {
+        put_string(out, zone.min_value);
+        put_string(out, zone.max_value);
+    }
+    out.append(reinterpret_cast<const char*>(zone.distinct.registers), HLL_REGISTERS);
+}
+
+static bool get_zone(const string& in, size_t& pos, ColumnZone& zone) {
+    uint64_t values, nulls;
+    if (!get_varint(in, pos, values) || !get_varint(in, pos, nulls)) return false;
+    zone.values = values;
+    zone.nulls = nulls;
+    if (values > 0 && (!get_string(in, pos, zone.min_value) || !get_string(in, pos, zone.max_value))) return false;
+    if (HLL_REGISTERS > in.size() - pos) return false;
+    memcpy(zone.distinct.registers, in.data() + pos, HLL_REGISTERS);
+    pos += HLL_REGISTERS;
+    return true;
+}
+
+// zone — статистика этих строк из таблицы или nullptr, если её нужно посчитать заново
+static void write_block(ofstream& file, CustVector<CustVector<string>>& columns, size_t rows, const ZoneBlock* zone) {
+    CustVector<ZoneBlock> computed;
+    if (!zone || zone->rows != rows || zone->columns.size != columns.size) {
+        CustVector<string> row;
+        for (size_t r = 0; r < rows; ++r) {
+            row.size = 0;
+            for (size_t c = 0; c < columns.size; ++c) row.push_back(columns[c][r]);
+            zone_add_row(computed, row);
+        }
+        zone = &computed[0];
+    }
+
+    string block;
+    put_varint(block, rows);
+    for (size_t c = 0; c < columns.size; ++c) {
+        put_zone(block, zone->columns[c]);
+        encode_column(columns[c], block);
+        columns[c].size = 0;  // Память столбца переиспользуется следующим блоком
+    }
+    string length;
+    put_varint(length, block.size());
+    file << length << block;
+}
+
+bool save_table_compressed(const Table& table) {
+    string file_name = table.name + ".tbl";
+    ofstream file(file_name + ".tmp", ios::binary);
+    if (!file.is_open()) {
+        cout << "Failed to open file for writing." << endl;
+        return false;
+    }
+
+    string header(TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    put_string(header, table.name);
+    put_string(header, table.primary_key);
+    put_varint(header, table.columns.size);
+    for (size_t i = 0; i < table.columns.size; ++i) {
+        put_string(header, table.columns[i]);
+    }
+    file << header;
+
+    // Строки копятся по столбцам и кодируются блоками по BLOCK_ROWS
+    CustVector<CustVector<string>> columns;
+    for (size_t i = 0; i < table.columns.size; ++i) {
+        columns.push_back(CustVector<string>());
+    }
+    size_t rows = 0;
+    size_t blocks = 0;
+    RowCursor cursor(table);
+    while (cursor.next()) {
+        const CustVector<string>& row = cursor.row();
+        if (row.size != table.columns.size) {
+            file.close();
+            error_code error;
+            filesystem::remove(file_name + ".tmp", error);
+            return false;
+        }
+        for (size_t c = 0; c < row.size; ++c) {
+            columns[c].push_back(row[c]);
+        }
+        if (++rows == BLOCK_ROWS) {
+            write_block(file, columns, rows, blocks < table.zones.size ? &table.zones[blocks] : nullptr);
+            ++blocks;
+            rows = 0;
+        }
+    }
+    if (rows > 0) {
+        write_block(file, columns, rows, blocks < table.zones.size ? &table.zones[blocks] : nullptr);
+    }
+    file << '\0';  // Блок нулевой длины — конец файла
+    file.close();
+    if (!file) {
+        cout << "Failed to write " << file_name << endl;
+        error_code error;
+        filesystem::remove(file_name + ".tmp", error);
+        return false;
+    }
+    return replace_file(file_name + ".tmp", file_name);
+}
+
+// Чтение заголовка прямо из потока, чтобы не загружать файл целиком
+static bool read_varint(istream& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == EOF) return false;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool read_bytes(istream& in, uint64_t length, string& value) {
+    value.resize(length);
+    return length == 0 || static_cast<bool>(in.read(&value[0], length));
+}
+
+static bool read_string(istream& in, string& value) {
+    uint64_t length;
+    return read_varint(in, length) && read_bytes(in, length, value);
+}
+
+static bool read_header(istream& in, Table& table, uint64_t& column_count) {
+    char magic[sizeof(TABLE_MAGIC)];
+    if (!in.read(magic, sizeof(magic))) return false;
+    if (memcmp(magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0) return false;
+    if (!read_string(in, table.name) || !read_string(in, table.primary_key) || !read_varint(in, column_count)) return false;
+    for (uint64_t i = 0; i < column_count; ++i) {
+        string column;
+        if (!read_string(in, column)) return false;
+        table.columns.push_back(column);
+    }
+    return true;
+}
+
+bool load_table_compressed(const string& table_name, Table& table) {
+    ifstream file(table_name + ".tbl", ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    uint64_t column_count;
+    if (!read_header(file, table, column_count)) {
+        cout << "Invalid table file format." << endl;
+        return false;
+    }
+
+    // В памяти только один блок: он раскодируется по столбцам и сразу переносится в хранилище таблицы
+    CustVector<CustVector<string>> columns;
+    for (uint64_t i = 0; i < column_count; ++i) {
+        columns.push_back(CustVector<string>());
+    }
+    CustVector<string> row;
+    string block;
+    while (true) {
+        uint64_t block_length, rows;
+        if (!read_varint(file, block_length) || !read_bytes(file, block_length, block)) {
+            cout << "Invalid table file format." << endl;
+            return false;
+        }
+        if (block_length == 0) break;
+
+        size_t at = 0;
+        if (!get_varint(block, at, rows)) {
+            cout << "Invalid table file format." << endl;
+            return false;
+        }
+        ZoneBlock zone;
+        zone.rows = rows;
+        for (size_t c = 0; c < columns.size; ++c) {
+            ColumnZone column_zone;
+            if (!get_zone(block, at, column_zone) || !decode_column(block, at, rows, columns[c])) {
+                cout << "Invalid table file format." << endl;
+                return false;
+            }
+            zone.columns.push_back(column_zone);
+        }
+        for (size_t r = 0; r < rows; ++r) {
+            row.size = 0;
+            for (size_t c = 0; c < columns.size; ++c) {
+                row.push_back(columns[c][r]);
+            }
+            if (!append_row(table, row, false)) {  // Статистика блока уже прочитана из файла
+                return false;  // Блок добавлен не целиком, его статистика не совпала бы со строками
+            }
+        }
+        table.zones.push_back(zone);
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <string>
+#include <atomic>
+#include "SUBBSAD.h"
+#include "ZoneMap.h"
+using namespace std;
+
+const size_t BLOCK_ROWS = ZONE_ROWS;  // Строк в одном блоке сжатого файла, совпадает с блоком статистики
+
+// Кодировки блока столбца, выбирается самая компактная
+enum ColumnEncoding : unsigned char {
+    ENC_PLAIN = 0,  // Длина и байты каждого значения
+    ENC_DICT_RLE = 1,  // Словарь и серии одинаковых индексов
+    ENC_DICT_PACKED = 2,  // Словарь и индексы, упакованные по битам
+    ENC_INT_FOR = 3,  // Целые: минимум блока и упакованные смещения от него
+    ENC_INT_DELTA = 4  // Целые: первое значение и упакованные разности соседних
+};
+
+extern atomic<bool> compress_tables;  // Сохранять таблицы в <name>.tbl вместо JSON
+
+// Сжатый поблочный формат таблицы. false, если таблицу нельзя записать в этом формате
+// (строки с разным числом значений) — тогда таблица сохраняется в JSON.
+bool save_table_compressed(const Table& table);
+// Блоки раскодируются по одному и переносятся строками в хранилище таблицы (в памяти или в страницах):
+// сжатие экономит диск и время чтения, сканы идут по обычным строкам.
+bool load_table_compressed(const string& table_name, Table& table);
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef CUSTVECTOR_H
+#define CUSTVECTOR_H
+
+#include <cstddef>
+#include <utility>
+
+// Самописная структура для хранения вектора
+template<typename T>
+struct CustVector {
+    T* data;  // Указатель на данные
+    size_t size;  // Текущий размер вектора
+    size_t capacity;  // Вместимость вектора
+
+    CustVector() : data(nullptr), size(0), capacity(0) {}  // Конструктор по умолчанию
+
+    CustVector(const CustVector& other) {  // Конструктор копирования
+        size = other.size;
+        capacity = other.capacity;
+        data = new T[capacity];
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = other.data[i];
+        }
+    }
+
+    CustVector& operator=(const CustVector& other) {  // Оператор присваивания
+        if (this != &other) {
+            delete[] data;
+            size = other.size;
+            capacity = other.capacity;
+            data = new T[capacity];
+            for (size_t i = 0; i < size; ++i) {
+                data[i] = other.data[i];
+            }
+        }
+        return *this;
+    }
+
+    CustVector(CustVector&& other) noexcept : data(other.data), size(other.size), capacity(other.capacity) {  // Конструктор перемещения
+        other.data = nullptr;
+        other.size = 0;
+        other.capacity = 0;
+    }
+
+    CustVector& operator=(CustVector&& other) noexcept {  // Перемещающее присваивание: память забирается без копирования
+        if (this != &other) {
+            delete[] data;
+            data = other.data;
+            size = other.size;
+            capacity = other.capacity;
+            other.data = nullptr;
+            other.size = 0;
+            other.capacity = 0;
+        }
+        return *this;
+    }
+
+    ~CustVector() {  // Деструктор
+        delete[] data;
+    }
+
+    void reserve(size_t new_capacity) {  // Выделение памяти заранее, элементы переносятся без копирования
+        if (new_capacity <= capacity) {
+            return;
+        }
+        T* new_data = new T[new_capacity];
+        for (size_t i = 0; i < size; ++i) {
+            new_data[i] = std::move(data[i]);
+        }
+        delete[] data;
+        data = new_data;
+        capacity = new_capacity;
+    }
+
+    void push_back(const T& value) {  // Добавление элемента в конец вектора
+        if (size == capacity) {
+            reserve(capacity == 0 ? 1 : capacity * 2);
+        }
+        data[size++] = value;
+    }
+
+    void push_back(T&& value) {  // Добавление с переносом: элемент забирает память value
+        if (size == capacity) {
+            reserve(capacity == 0 ? 1 : capacity * 2);
+        }
+        data[size++] = std::move(value);
+    }
+
+    T& operator[](size_t index) {  // Оператор доступа по индексу
+        return data[index];
+    }
+
+    const T& operator[](size_t index) const {  // Константный оператор доступа по индексу
+        return data[index];
+    }
+};
+
+#endif
@@ -16,7 +16,7 @@ HashTable::~HashTable() {
         while (entry) {
             HashNode* prev = entry;
             entry = entry->next;
-            delete prev;
+            nodes.destroy(prev);
         }
         table[i] = nullptr;
     }
@@ -40,7 +40,7 @@ void HashTable::insert(const std::string& key, void* value) {
         entry = entry->next;
     }
     if (!entry) {
-        entry = new HashNode(key, value);
+        entry = nodes.create(key, value);
         if (prev) {
             prev->next = entry;
         }
@@ -88,7 +88,7 @@ void HashTable::remove(const std::string& key) {
     else {
         table[index] = entry->next;
     }
-    delete entry;
+    nodes.destroy(entry);
 }
 
 void HashTable::print() const {
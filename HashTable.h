@@ -4,6 +4,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include "Allocator.h"
 using namespace std;
 
 class HashNode {
@@ -19,6 +20,7 @@ class HashTable {
 private:
     HashNode** table;
     int capacity;
+    NodePool<HashNode> nodes;  //  
 
     int hash(const string& key) const;
 
@@ -0,0 +1,407 @@
+#include "MaterializedView.h"
+#include "Planner.h"
+#include "BufferPool.h"
+#include "Persistence.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <unordered_map>
+
+using namespace std;
+
+static CustVector<MaterializedView> views;  // Определения всех представлений
+static mutex views_lock;
+
+// Базовые таблицы, план и позиции выбранных столбцов для вычисления представления
+struct ViewQuery {
+    CustVector<Table*> inputs;
+    QueryPlan plan;
+    CustVector<size_t> first_positions;
+    CustVector<size_t> second_positions;
+};
+
+static bool find_view(const string& view_name, MaterializedView& view) {
+    lock_guard<mutex> guard(views_lock);
+    for (size_t i = 0; i < views.size; ++i) {
+        if (views[i].name == view_name) {
+            view = views[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static void set_stale(const string& view_name, bool stale) {
+    lock_guard<mutex> guard(views_lock);
+    for (size_t i = 0; i < views.size; ++i) {
+        if (views[i].name == view_name) {
+            views[i].stale = stale;
+            return;
+        }
+    }
+}
+
+// Представления, которые читают таблицу table_name
+static CustVector<MaterializedView> views_on(const string& table_name) {
+    CustVector<MaterializedView> result;
+    lock_guard<mutex> guard(views_lock);
+    for (size_t i = 0; i < views.size; ++i) {
+        for (size_t j = 0; j < views[i].table_names.size; ++j) {
+            if (views[i].table_names[j] == table_name) {
+                result.push_back(views[i]);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+static bool prepare_query(const MaterializedView& view, ViewQuery& query) {
+    for (size_t i = 0; i < view.table_names.size && i < 2; ++i) {
+        Table* table = reinterpret_cast<Table*>(tables.get(view.table_names[i]));
+        if (!table) {
+            cout << "Table not found: " << view.table_names[i] << endl;
+            return false;
+        }
+        query.inputs.push_back(table);
+    }
+    if (query.inputs.size == 0 || !plan_select(query.inputs, view.condition, query.plan)) {
+        return false;
+    }
+
+    CustVector<string> selected = view.columns;
+    if (view.columns.size == 1 && view.columns[0] == "*") {
+        selected = query.inputs[0]->columns;
+    }
+    Table* second = query.inputs.size > 1 ? query.inputs[1] : nullptr;
+    resolve_projection(selected, *query.inputs[0], second, query.first_positions, query.second_positions);
+    for (size_t j = 0; j < selected.size; ++j) {
+        if (query.first_positions[j] == string::npos && query.second_positions[j] == string::npos) {
+            cout << "Column not found: " << selected[j] << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Столбцы таблицы представления: столбец из обеих таблиц получает имя с префиксом таблицы
+static CustVector<string> view_columns(const MaterializedView& view, const ViewQuery& query) {
+    CustVector<string> selected = view.columns;
+    if (view.columns.size == 1 && view.columns[0] == "*") {
+        selected = query.inputs[0]->columns;
+    }
+    CustVector<string> columns;
+    for (size_t j = 0; j < selected.size; ++j) {
+        bool both = query.first_positions[j] != string::npos && query.second_positions[j] != string::npos;
+        if (query.first_positions[j] != string::npos) {
+            columns.push_back(both ? query.inputs[0]->name + "." + selected[j] : selected[j]);
+        }
+        if (query.second_positions[j] != string::npos) {
+            columns.push_back(both ? query.inputs[1]->name + "." + selected[j] : selected[j]);
+        }
+    }
+    return columns;
+}
+
+// Строка представления в том же порядке значений, что и вывод SELECT
+static CustVector<string> project(const ViewQuery& query, const CustVector<string>& first_row, const CustVector<string>* second_row) {
+    CustVector<string> row;
+    for (size_t j = 0; j < query.first_positions.size; ++j) {
+        size_t first = query.first_positions[j];
+        size_t second = query.second_positions[j];
+        if (first != string::npos) {
+            row.push_back(first < first_row.size ? first_row[first] : "");
+        }
+        if (second != string::npos && second_row) {
+            row.push_back(second < second_row->size ? (*second_row)[second] : "");
+        }
+    }
+    return row;
+}
+
+static bool compute_view(const MaterializedView& view, Table& result) {
+    ViewQuery query;
+    if (!prepare_query(view, query)) {
+        return false;
+    }
+    init_storage(result);
+    result.columns = view_columns(view, query);
+    bool stored = true;  // Все строки поместились в хранилище; иначе представление не заменяется неполным
+    if (query.inputs.size == 1) {
+        scan_input(query.plan.inputs[0], [&](const CustVector<string>& row) {
+            if (stored) stored = append_row(result, project(query, row, nullptr));
+        });
+    }
+    else {
+        execute_join(query.plan, [&](const CustVector<string>& first_row, const CustVector<string>& second_row) {
+            if (stored) stored = append_row(result, project(query, first_row, &second_row));
+        });
+    }
+    return stored;
+}
+
+// Строки представления, которые даёт строка row таблицы с номером role в FROM
+static void view_rows_for(ViewQuery& query, size_t role, const CustVector<string>& row, CustVector<CustVector<string>>& result) {
+    if (!row_matches(row, query.plan.inputs[role].filters)) {
+        return;
+    }
+    if (query.inputs.size == 1) {
+        result.push_back(project(query, row, nullptr));
+        return;
+    }
+
+    // Парные строки другой таблицы: её условия и равенство ключей соединения значениям строки
+    size_t other = 1 - role;
+    AccessPlan access = query.plan.inputs[other];
+    for (size_t k = 0; k < query.plan.keys.size; ++k) {
+        size_t column = query.plan.keys[k].columns[role];
+        if (column >= row.size) return;
+        access.filters.push_back({ query.plan.keys[k].columns[other], "=", row[column] });
+    }
+    plan_access(access);
+    scan_input(access, [&](const CustVector<string>& other_row) {
+        if (role == 0) result.push_back(project(query, row, &other_row));
+        else result.push_back(project(query, other_row, &row));
+    });
+}
+
+// DELETE перенумеровывает первый столбец таблицы, поэтому такие представления пересчитываются целиком
+static bool reads_renumbered_column(const ViewQuery& query, size_t role) {
+    const CustVector<Filter>& filters = query.plan.inputs[role].filters;
+    for (size_t f = 0; f < filters.size; ++f) {
+        if (filters[f].column == 0) return true;
+    }
+    for (size_t k = 0; k < query.plan.keys.size; ++k) {
+        if (query.plan.keys[k].columns[role] == 0) return true;
+    }
+    const CustVector<size_t>& positions = role == 0 ? query.first_positions : query.second_positions;
+    for (size_t j = 0; j < positions.size; ++j) {
+        if (positions[j] == 0) return true;
+    }
+    return false;
+}
+
+static void save_view_definition(const MaterializedView& view) {
+    ofstream file(view.name + "_view.txt");
+    if (!file.is_open()) {
+        cout << "Failed to open file for writing view definition." << endl;
+        return;
+    }
+    for (size_t i = 0; i < view.table_names.size; ++i) {
+        file << (i > 0 ? "," : "") << view.table_names[i];
+    }
+    file << endl;
+    for (size_t i = 0; i < view.columns.size; ++i) {
+        file << (i > 0 ? "," : "") << view.columns[i];
+    }
+    file << endl << view.condition << endl;
+}
+
+static void register_view(const MaterializedView& view) {
+    lock_guard<mutex> guard(views_lock);
+    for (size_t i = 0; i < views.size; ++i) {
+        if (views[i].name == view.name) {
+            views[i] = view;
+            return;
+        }
+    }
+    views.push_back(view);
+}
+
+void create_materialized_view(const string& view_name, const CustVector<string>& table_names, const CustVector<string>& columns, const string& condition) {
+    MaterializedView existing;
+    if (find_view(view_name, existing) || tables.get(view_name)) {
+        cout << "Table already exists." << endl;
+        return;
+    }
+
+    MaterializedView view;
+    view.name = view_name;
+    view.table_names = table_names;
+    view.columns = columns;
+    view.condition = condition;
+
+    Table* table = new Table(view_name);
+    if (!compute_view(view, *table)) {
+        delete table;
+        return;
+    }
+    tables.put(view_name, reinterpret_cast<void*>(table));
+    register_view(view);
+    save_view_definition(view);
+    persistence.submit(table);
+    cout << "Materialized view created: " << row_count(*table) << " rows." << endl;
+}
+
+void refresh_materialized_view(const string& view_name) {
+    MaterializedView view;
+    Table* table = reinterpret_cast<Table*>(tables.get(view_name));
+    if (!find_view(view_name, view) || !table) {
+        cout << "Materialized view not found." << endl;
+        return;
+    }
+
+    Table fresh(view_name);
+    if (!compute_view(view, fresh)) {
+        return;
+    }
+    unique_lock<mutex> guard(table->lock);
+    table->columns = fresh.columns;
+    table->rows = fresh.rows;
+    table->paged = fresh.paged;
+    table->visible_rows = fresh.visible_rows;
+    table->zones = fresh.zones;
+    bump_version(*table);
+    size_t rows = row_count(*table);
+    guard.unlock();
+    set_stale(view_name, false);
+    persistence.submit(table);
+    cout << "Materialized view refreshed: " << rows << " rows." << endl;
+}
+
+bool load_view_definition(const string& view_name) {
+    ifstream file(view_name + "_view.txt");
+    if (!file.is_open()) {
+        return false;
+    }
+    MaterializedView view;
+    view.name = view_name;
+    string line, item;
+    getline(file, line);
+    istringstream table_list(line);
+    while (getline(table_list, item, ',')) {
+        view.table_names.push_back(item);
+    }
+    getline(file, line);
+    istringstream column_list(line);
+    while (getline(column_list, item, ',')) {
+        view.columns.push_back(item);
+    }
+    getline(file, view.condition);
+    // Пока определение не было зарегистрировано, изменения базовых таблиц в представление не попадали
+    view.stale = true;
+    register_view(view);
+    cout << "Materialized view definition loaded from " << view_name << "_view.txt" << endl;
+    if (tables.get(view_name)) {
+        refresh_materialized_view(view_name);
+    }
+    return true;
+}
+
+void load_view_definitions() {
+    const string suffix = "_view.txt";
+    error_code error;
+    for (const auto& entry : filesystem::directory_iterator(".", error)) {
+        string file_name = entry.path().filename().string();
+        if (file_name.size() <= suffix.size() || file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        string view_name = file_name.substr(0, file_name.size() - suffix.size());
+        if (filesystem::exists(view_name + ".tbl") || filesystem::exists(view_name + ".json")) {  // Таблицы схемы представлениями не бывают
+            load_table(view_name);
+        }
+        load_view_definition(view_name);
+    }
+}
+
+bool is_materialized_view(const string& table_name) {
+    MaterializedView view;
+    return find_view(table_name, view);
+}
+
+bool has_views(const string& table_name) {
+    return views_on(table_name).size > 0;
+}
+
+void views_after_insert(const string& table_name, const CustVector<string>& row) {
+    CustVector<MaterializedView> affected = views_on(table_name);
+    for (size_t v = 0; v < affected.size; ++v) {
+        const MaterializedView& view = affected[v];
+        Table* table = reinterpret_cast<Table*>(tables.get(view.name));
+        ViewQuery query;
+        if (!table || !prepare_query(view, query)) {
+            set_stale(view.name, true);  // Изменение пропущено, представление пересчитается при следующем
+            continue;
+        }
+        if (view.stale || (query.inputs.size > 1 && query.inputs[0] == query.inputs[1])) {
+            refresh_materialized_view(view.name);  // Устаревшее представление и самосоединение проще пересчитать
+            continue;
+        }
+        size_t role = view.table_names[0] == table_name ? 0 : 1;
+
+        CustVector<CustVector<string>> added;
+        view_rows_for(query, role, row, added);
+        if (added.size == 0) continue;
+
+        unique_lock<mutex> guard(table->lock);
+        for (size_t i = 0; i < added.size; ++i) {
+            append_row(*table, added[i]);
+        }
+        bump_version(*table);
+        guard.unlock();
+        persistence.submit(table);
+    }
+}
+
+void views_after_delete(const string& table_name, const CustVector<CustVector<string>>& deleted) {
+    CustVector<MaterializedView> affected = views_on(table_name);
+    for (size_t v = 0; v < affected.size; ++v) {
+        const MaterializedView& view = affected[v];
+        Table* table = reinterpret_cast<Table*>(tables.get(view.name));
+        ViewQuery query;
+        if (!table || !prepare_query(view, query)) {
+            set_stale(view.name, true);
+            continue;
+        }
+        size_t role = view.table_names[0] == table_name ? 0 : 1;
+        if (view.stale || (query.inputs.size > 1 && query.inputs[0] == query.inputs[1]) || reads_renumbered_column(query, role)) {
+            refresh_materialized_view(view.name);
+            continue;
+        }
+
+        // Сколько раз убрать каждую строку представления: строки могут повторяться
+        unordered_map<string, size_t> removed;
+        for (size_t d = 0; d < deleted.size; ++d) {
+            CustVector<CustVector<string>> rows;
+            view_rows_for(query, role, deleted[d], rows);
+            for (size_t i = 0; i < rows.size; ++i) {
+                string key;
+                for (size_t j = 0; j < rows[i].size; ++j) {
+                    key += rows[i][j];
+                    key += '\x1f';
+                }
+                ++removed[key];
+            }
+        }
+        if (removed.empty()) continue;
+
+        // Оставшиеся строки переносятся в новое хранилище, как в delete_data
+        unique_lock<mutex> guard(table->lock);
+        Table survivors(table->name);
+        if (table->paged) {
+            survivors.paged = make_shared<PagedRows>(table->name);
+        }
+        RowCursor cursor(*table);
+        while (cursor.next()) {
+            const CustVector<string>& row = cursor.row();
+            string key;
+            for (size_t j = 0; j < row.size; ++j) {
+                key += row[j];
+                key += '\x1f';
+            }
+            auto it = removed.find(key);
+            if (it != removed.end() && it->second > 0) {
+                --it->second;
+                continue;
+            }
+            append_row(survivors, row);
+        }
+        table->rows = survivors.rows;
+        table->paged = survivors.paged;
+        table->visible_rows = survivors.visible_rows;
+        table->zones = survivors.zones;
+        bump_version(*table);
+        guard.unlock();
+        persistence.submit(table);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef MATERIALIZEDVIEW_H
+#define MATERIALIZEDVIEW_H
+
+#include <string>
+#include "SUBBSAD.h"
+using namespace std;
+
+// Материализованное представление: результат SELECT хранится как обычная таблица
+// и обновляется по строкам, вставленным в базовые таблицы и удалённым из них.
+struct MaterializedView {
+    string name;
+    CustVector<string> table_names;  // Базовые таблицы в порядке FROM
+    CustVector<string> columns;  // Выбранные столбцы, как в SELECT
+    string condition;
+    bool stale = false;  // Содержимое могло отстать от базовых таблиц: пересчитывается перед следующим обновлением
+};
+
+void create_materialized_view(const string& view_name, const CustVector<string>& table_names, const CustVector<string>& columns, const string& condition);
+void refresh_materialized_view(const string& view_name);
+// Восстанавливает определение из <name>_view.txt и пересчитывает представление, false — таблица не представление
+bool load_view_definition(const string& view_name);
+void load_view_definitions();  // Все определения <name>_view.txt текущего каталога, при запуске после таблиц схемы
+bool is_materialized_view(const string& table_name);
+bool has_views(const string& table_name);  // Есть ли представления, читающие таблицу
+
+// Вызываются после изменения базовой таблицы, без её мьютекса
+void views_after_insert(const string& table_name, const CustVector<string>& row);
+void views_after_delete(const string& table_name, const CustVector<CustVector<string>>& deleted);
+
+#endif
@@ -0,0 +1,196 @@
+#include "Persistence.h"
+
+using namespace std;
+
+PersistenceQueue persistence;  // Общая очередь сохранения для всех таблиц
+
+PersistenceQueue::PersistenceQueue(size_t capacity)
+    : capacity(capacity), head(0), count(0), submitted(0), flushed(0), durability(Durability::Sync), deferring(false), running(false) {
+    queue = new Table * [capacity]();
+}
+
+PersistenceQueue::~PersistenceQueue() {
+    stop();
+    delete[] queue;
+}
+
+bool PersistenceQueue::submit(Table* table) {
+    unique_lock<mutex> guard(queue_lock);
+    if (deferring) {
+        for (size_t i = 0; i < deferred.size; ++i) {
+            if (deferred[i] == table) return true;
+        }
+        deferred.push_back(table);
+        return true;
+    }
+    enqueue(table, guard);
+    unsigned long long ticket = submitted;
+
+    if (durability == Durability::Sync) {
+        done.wait(guard, [this, ticket] { return flushed >= ticket; });
+        return !is_failed(table);  // Пакет с этим изменением записан, но таблица могла не сохраниться
+    }
+    return true;
+}
+
+void PersistenceQueue::enqueue(Table* table, unique_lock<mutex>& guard) {
+    if (!running) {  // Поток запускается при первом изменении
+        running = true;
+        worker = thread(&PersistenceQueue::run, this);
+    }
+    ++submitted;
+
+    // Если таблица уже ждёт сохранения, её снимок всё равно будет снят позже — новое место не нужно
+    bool pending = false;
+    for (size_t i = 0; i < count; ++i) {
+        if (queue[(head + i) % capacity] == table) {
+            pending = true;
+            break;
+        }
+    }
+    if (!pending) {
+        not_full.wait(guard, [this] { return count < capacity; });
+        queue[(head + count) % capacity] = table;
+        ++count;
+        not_empty.notify_one();
+    }
+}
+
+// Неудавшиеся таблицы снова ставятся в очередь; из списка они уходят только после успешной записи
+void PersistenceQueue::retry_failed(unique_lock<mutex>& guard) {
+    CustVector<Table*> retry = failed;  // enqueue может отпустить мьютекс, пока ждёт места
+    for (size_t i = 0; i < retry.size; ++i) {
+        enqueue(retry[i], guard);
+    }
+}
+
+bool PersistenceQueue::is_failed(Table* table) {
+    for (size_t i = 0; i < failed.size; ++i) {
+        if (failed[i] == table) return true;
+    }
+    return false;
+}
+
+void PersistenceQueue::mark_written(Table* table, bool written) {
+    for (size_t i = 0; i < failed.size; ++i) {
+        if (failed[i] == table) {
+            if (written) {
+                failed[i] = failed[failed.size - 1];
+                --failed.size;
+            }
+            return;
+        }
+    }
+    if (!written) {
+        failed.push_back(table);
+    }
+}
+
+bool PersistenceQueue::flush() {
+    unique_lock<mutex> guard(queue_lock);
+    retry_failed(guard);
+    unsigned long long ticket = submitted;
+    done.wait(guard, [this, ticket] { return flushed >= ticket; });
+    return failed.size == 0;
+}
+
+void PersistenceQueue::forget(Table* table) {
+    lock_guard<mutex> guard(queue_lock);
+    mark_written(table, true);
+}
+
+bool PersistenceQueue::setDeferred(bool on) {
+    {
+        lock_guard<mutex> guard(queue_lock);
+        deferring = on;
+    }
+    if (!on) {
+        return checkpoint();  // Отложенные изменения не должны потеряться при выходе из режима
+    }
+    return true;
+}
+
+bool PersistenceQueue::checkpoint() {
+    {
+        unique_lock<mutex> guard(queue_lock);
+        for (size_t i = 0; i < deferred.size; ++i) {
+            enqueue(deferred[i], guard);
+        }
+        deferred = CustVector<Table*>();
+    }
+    return flush();
+}
+
+void PersistenceQueue::stop() {
+    {
+        unique_lock<mutex> guard(queue_lock);
+        for (size_t i = 0; i < deferred.size; ++i) {
+            enqueue(deferred[i], guard);  // Отложенные таблицы тоже записываются перед выходом
+        }
+        deferred = CustVector<Table*>();
+        retry_failed(guard);  // Последняя попытка записать то, что не удалось раньше
+        if (!running) return;
+        running = false;
+    }
+    not_empty.notify_all();
+    worker.join();  // Поток дописывает очередь перед выходом
+}
+
+void PersistenceQueue::setDurability(Durability level) {
+    lock_guard<mutex> guard(queue_lock);
+    durability = level;
+}
+
+Durability PersistenceQueue::getDurability() {
+    lock_guard<mutex> guard(queue_lock);
+    return durability;
+}
+
+void PersistenceQueue::run() {
+    Table** batch = new Table * [capacity];
+    bool* written = new bool[capacity];
+    while (true) {
+        size_t batch_size = 0;
+        unsigned long long batch_ticket;
+        {
+            unique_lock<mutex> guard(queue_lock);
+            not_empty.wait(guard, [this] { return count > 0 || !running; });
+            if (count == 0 && !running) break;
+
+            // Забираем всю очередь целиком: все изменения до этого момента попадут в снимки ниже
+            while (count > 0) {
+                batch[batch_size++] = queue[head];
+                head = (head + 1) % capacity;
+                --count;
+            }
+            batch_ticket = submitted;
+            not_full.notify_all();
+        }
+
+        write_batch(batch, batch_size, written);
+
+        {
+            lock_guard<mutex> guard(queue_lock);
+            for (size_t i = 0; i < batch_size; ++i) {
+                mark_written(batch[i], written[i]);
+            }
+            flushed = batch_ticket;
+        }
+        done.notify_all();
+    }
+    delete[] written;
+    delete[] batch;
+}
+
+void PersistenceQueue::write_batch(Table** batch, size_t batch_size, bool* written) {
+    for (size_t i = 0; i < batch_size; ++i) {
+        Table* table = batch[i];
+        // Под мьютексом копируется только описание таблицы: хранилище строк общее,
+        // снимок видит строки на момент копирования, а сериализация идёт без блокировки
+        table->lock.lock();
+        Table snapshot(*table);
+        table->lock.unlock();
+
+        written[i] = !save_table(snapshot).empty();  // Сохранение таблицы на диск (граница ключей пишется блоками в next_pk)
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef PERSISTENCE_H
+#define PERSISTENCE_H
+
+#include <string>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "SUBBSAD.h"
+using namespace std;
+
+// Уровень долговечности: когда вызывающий получает подтверждение записи
+enum class Durability {
+    Sync,   // После того, как изменение записано на диск (групповой коммит)
+    Async   // Сразу после постановки в очередь
+};
+
+// Фоновый поток сохранения таблиц с ограниченной очередью.
+// Изменения нескольких писателей одной таблицы сливаются в одну запись на диск.
+class PersistenceQueue {
+private:
+    Table** queue;  // Кольцевой буфер таблиц, ожидающих сохранения
+    size_t capacity;
+    size_t head;
+    size_t count;
+    unsigned long long submitted;  // Номер последнего поставленного изменения
+    unsigned long long flushed;  // Номер последнего изменения, записанного на диск
+    Durability durability;
+    bool deferring;  // Пакетный режим: изменения только отмечаются, запись в checkpoint()
+    CustVector<Table*> deferred;  // Таблицы, изменённые с последней контрольной точки
+    CustVector<Table*> failed;  // Таблицы, последняя запись которых не удалась: не считаются сохранёнными
+    bool running;
+    thread worker;
+    mutex queue_lock;
+    condition_variable not_empty;
+    condition_variable not_full;
+    condition_variable done;
+
+    void enqueue(Table* table, unique_lock<mutex>& guard);
+    void retry_failed(unique_lock<mutex>& guard);
+    bool is_failed(Table* table);
+    void mark_written(Table* table, bool written);
+    void run();
+    void write_batch(Table** batch, size_t batch_size, bool* written);
+
+public:
+    PersistenceQueue(size_t capacity = 64);
+    ~PersistenceQueue();
+
+    // Поставить таблицу в очередь и дождаться подтверждения по уровню долговечности.
+    // false в режиме Sync, если таблицу не удалось записать: она останется в повторных попытках.
+    bool submit(Table* table);
+    bool flush();  // Повторить неудавшиеся записи и дождаться записи всех изменений; false, если что-то не записано
+    bool setDeferred(bool on);  // Откладывать запись изменённых таблиц до checkpoint(); при выключении — её результат
+    bool checkpoint();  // Записать таблицы, изменённые в отложенном режиме, и дождаться записи
+    void forget(Table* table);  // Убрать таблицу из повторных попыток перед её удалением
+    void stop();
+    void setDurability(Durability level);
+    Durability getDurability();
+};
+
+extern PersistenceQueue persistence;
+
+#endif
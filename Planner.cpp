@@ -0,0 +1,518 @@
+#include "Planner.h"
+#include "BufferPool.h"
+#include "Allocator.h"
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+void KeyIndex::reset() {
+    lock_guard<mutex> guard(lock);
+    positions.clear();
+    indexed_rows = 0;
+}
+
+static size_t primary_key_column(const Table& table) {
+    for (size_t j = 0; j < table.columns.size; ++j) {
+        if (table.columns[j] == table.primary_key) return j;
+    }
+    return string::npos;
+}
+
+// Номер столбца по имени, в том числе в виде "таблица.столбец"
+static size_t resolve_column(const Table& table, const string& name) {
+    string column = name;
+    size_t dot = name.find('.');
+    if (dot != string::npos) {
+        if (name.substr(0, dot) != table.name) return string::npos;
+        column = name.substr(dot + 1);
+    }
+    for (size_t j = 0; j < table.columns.size; ++j) {
+        if (table.columns[j] == column) return j;
+    }
+    return string::npos;
+}
+
+bool row_matches(const CustVector<string>& row, const CustVector<Filter>& filters) {
+    for (size_t f = 0; f < filters.size; ++f) {
+        const Filter& filter = filters[f];
+        if (filter.column >= row.size || !match_condition(row[filter.column], filter.op, filter.value)) return false;
+    }
+    return true;
+}
+
+// Дописывает в индекс строки, добавленные после последнего обращения
+static void update_index(Table& table, KeyIndex& index) {
+    size_t key_column = primary_key_column(table);
+    lock_guard<mutex> table_guard(table.lock);  // Вставки дописывают строки под этим же мьютексом
+    lock_guard<mutex> index_guard(index.lock);
+    if (key_column == string::npos || index.indexed_rows >= row_count(table)) return;
+
+    RowCursor cursor(table);
+    cursor.seek(index.indexed_rows);
+    while (cursor.next()) {
+        const CustVector<string>& row = cursor.row();
+        if (key_column < row.size) {
+            index.positions.emplace(row[key_column], index.indexed_rows);
+        }
+        ++index.indexed_rows;
+    }
+}
+
+// Номера строк с заданным первичным ключом, по возрастанию
+static void index_lookup(Table& table, const string& key, CustVector<size_t>& positions) {
+    shared_ptr<KeyIndex> index = table.pk_index;
+    if (!index) return;
+    update_index(table, *index);
+
+    unique_lock<mutex> guard(index->lock);
+    auto range = index->positions.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        positions.push_back(it->second);
+    }
+    guard.unlock();
+    sort(positions.data, positions.data + positions.size);
+}
+
+// Оценка числа различных значений: по ANALYZE, иначе по статистике блоков
+static double distinct_values(const Table& table, size_t column) {
+    if (table.stats && column < table.stats->columns.size && table.stats->columns[column].distinct > 0) {
+        return static_cast<double>(table.stats->columns[column].distinct);
+    }
+    HyperLogLog merged;
+    for (size_t b = 0; b < table.zones.size; ++b) {
+        if (column < table.zones[b].columns.size) {
+            merged.merge(table.zones[b].columns[column].distinct);
+        }
+    }
+    return max<double>(1, static_cast<double>(merged.estimate()));
+}
+
+// Доля строк, удовлетворяющих условию
+static double selectivity(const Table& table, const Filter& filter) {
+    const ColumnStats* stats = nullptr;
+    if (table.stats && filter.column < table.stats->columns.size) {
+        stats = &table.stats->columns[filter.column];
+    }
+    double equal = 1.0 / distinct_values(table, filter.column);
+    if (stats && stats->bounds.size > 1) {
+        // Частое значение занимает несколько корзин гистограммы
+        size_t hits = 0;
+        for (size_t i = 0; i < stats->bounds.size; ++i) {
+            if (stats->bounds[i] == filter.value) ++hits;
+        }
+        if (hits > 1) equal = max(equal, static_cast<double>(hits - 1) / (stats->bounds.size - 1));
+    }
+    if (filter.op == "=") return equal;
+    if (filter.op == "!=") return 1 - equal;
+    if (filter.op != "<" && filter.op != "<=" && filter.op != ">" && filter.op != ">=") return 1;
+    if (!stats || stats->bounds.size < 2) return 1.0 / 3;  // Без гистограммы — обычная оценка для диапазона
+
+    // Доля значений меньше заданного: сколько границ гистограммы левее него
+    size_t below = 0;
+    for (size_t i = 0; i < stats->bounds.size; ++i) {
+        if (compare_values(stats->bounds[i], filter.value) < 0) ++below;
+    }
+    double less = 0;
+    if (below == stats->bounds.size) less = 1;
+    else if (below > 0) less = (below - 0.5) / (stats->bounds.size - 1);
+
+    double result = 0;
+    if (filter.op == "<") result = less;
+    else if (filter.op == "<=") result = less + equal;
+    else if (filter.op == ">") result = 1 - less - equal;
+    else result = 1 - less;
+    return min(1.0, max(0.0, result));
+}
+
+// Сколько строк прочитает скан, пропуская блоки, где условие заведомо ложно
+static double scanned_rows(const Table& table, const Filter& filter) {
+    size_t total = row_count(table);
+    size_t covered = 0;
+    size_t scanned = 0;
+    for (size_t b = 0; b < table.zones.size; ++b) {
+        covered += table.zones[b].rows;
+        if (zone_may_match(table.zones[b], filter.column, filter.op, filter.value)) {
+            scanned += table.zones[b].rows;
+        }
+    }
+    return static_cast<double>(scanned + (total > covered ? total - covered : 0));
+}
+
+void plan_access(AccessPlan& access) {
+    const Table& table = *access.table;
+    access.zone_filter = string::npos;
+    access.index_filter = string::npos;
+    double rows = static_cast<double>(row_count(table));
+    access.rows = rows;
+    for (size_t f = 0; f < access.filters.size; ++f) {
+        access.rows *= selectivity(table, access.filters[f]);
+    }
+
+    // Скан пропускает блоки по самому избирательному по статистике блоков условию
+    access.method = ACCESS_FULL_SCAN;
+    access.cost = rows;
+    for (size_t f = 0; f < access.filters.size; ++f) {
+        double scanned = scanned_rows(table, access.filters[f]);
+        if (scanned < access.cost) {
+            access.cost = scanned;
+            access.zone_filter = f;
+        }
+    }
+
+    // Поиск по индексу: обращение к хешу и чтение найденных строк
+    size_t key_column = primary_key_column(table);
+    if (!table.pk_index || key_column == string::npos) return;
+    for (size_t f = 0; f < access.filters.size; ++f) {
+        if (access.filters[f].column != key_column || access.filters[f].op != "=") continue;
+        double cost = 1 + access.rows;
+        if (cost < access.cost) {
+            access.method = ACCESS_INDEX_LOOKUP;
+            access.index_filter = f;
+            access.cost = cost;
+        }
+    }
+}
+
+bool plan_select(const CustVector<Table*>& inputs, const string& condition, QueryPlan& plan) {
+    plan = QueryPlan();
+    for (size_t i = 0; i < inputs.size; ++i) {
+        AccessPlan access;
+        access.table = inputs[i];
+        plan.inputs.push_back(access);
+    }
+
+    // Условие: столбец op значение, несколько условий через AND
+    istringstream iss(condition);
+    string column, op, value;
+    while (iss >> column) {
+        if (!(iss >> op >> value)) {
+            cout << "Invalid condition format." << endl;
+            return false;
+        }
+
+        // Удаление лишних символов из значения
+        if (!value.empty() && value.front() == '(') value = value.substr(1);
+        if (!value.empty() && value.back() == ')') value = value.substr(0, value.size() - 1);
+
+        // Равенство столбцов двух таблиц — условие соединения
+        bool joined = false;
+        for (size_t left = 0; op == "=" && inputs.size == 2 && left < 2 && !joined; ++left) {
+            size_t left_column = resolve_column(*inputs[left], column);
+            size_t right_column = resolve_column(*inputs[1 - left], value);
+            if (left_column != string::npos && right_column != string::npos) {
+                JoinKey key;
+                key.columns[left] = left_column;
+                key.columns[1 - left] = right_column;
+                plan.keys.push_back(key);
+                joined = true;
+            }
+        }
+
+        // Условие со значением опускается к каждой таблице, где есть столбец
+        bool found = joined;
+        for (size_t i = 0; i < inputs.size && !joined; ++i) {
+            size_t index = resolve_column(*inputs[i], column);
+            if (index != string::npos) {
+                plan.inputs[i].filters.push_back({ index, op, value });
+                found = true;
+            }
+        }
+        if (!found) {
+            cout << "Column not found: " << column << endl;
+            return false;
+        }
+
+        string conjunction;
+        if (iss >> conjunction && conjunction != "AND" && conjunction != "and") {
+            cout << "Invalid condition format." << endl;
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < plan.inputs.size; ++i) {
+        plan_access(plan.inputs[i]);
+    }
+    plan.rows = plan.inputs[0].rows;
+    plan.cost = plan.inputs[0].cost;
+    if (plan.inputs.size < 2) return true;
+
+    // В память читается таблица с меньшей оценкой строк после условий
+    const AccessPlan& first = plan.inputs[0];
+    const AccessPlan& second = plan.inputs[1];
+    plan.inner = second.rows <= first.rows ? 1 : 0;
+    double inner_rows = plan.inputs[plan.inner].rows;
+    double outer_rows = plan.inputs[1 - plan.inner].rows;
+    double read_cost = first.cost + second.cost;
+
+    plan.rows = first.rows * second.rows;
+    for (size_t k = 0; k < plan.keys.size; ++k) {
+        plan.rows /= max(distinct_values(*first.table, plan.keys[k].columns[0]), distinct_values(*second.table, plan.keys[k].columns[1]));
+    }
+
+    double nested_cost = read_cost + outer_rows * inner_rows;
+    double hash_cost = read_cost + inner_rows + outer_rows + plan.rows;  // Построение, проход и совпадения
+    if (plan.keys.size > 0 && hash_cost < nested_cost) {
+        plan.join = JOIN_HASH;
+        plan.cost = hash_cost;
+    }
+    else {
+        plan.join = JOIN_NESTED_LOOP;
+        plan.cost = nested_cost;
+    }
+    return true;
+}
+
+void resolve_projection(const CustVector<string>& selected, const Table& first, const Table* second, CustVector<size_t>& first_positions, CustVector<size_t>& second_positions) {
+    first_positions = CustVector<size_t>();
+    second_positions = CustVector<size_t>();
+    for (size_t j = 0; j < selected.size; ++j) {
+        first_positions.push_back(string::npos);
+        second_positions.push_back(string::npos);
+        for (size_t k = 0; k < first.columns.size; ++k) {
+            if (first.columns[k] == selected[j]) {
+                first_positions[j] = k;
+                break;
+            }
+        }
+        for (size_t k = 0; second && k < second->columns.size; ++k) {
+            if (second->columns[k] == selected[j]) {
+                second_positions[j] = k;
+                break;
+            }
+        }
+    }
+}
+
+static string describe_filter(const AccessPlan& access, const Filter& filter) {
+    return access.table->columns[filter.column] + " " + filter.op + " " + filter.value;
+}
+
+static void explain_access(const AccessPlan& access) {
+    cout << "  " << access.table->name << ": ";
+    if (access.method == ACCESS_INDEX_LOOKUP) {
+        cout << "index lookup " << describe_filter(access, access.filters[access.index_filter]);
+    }
+    else {
+        cout << "full scan";
+        if (access.zone_filter != string::npos) {
+            cout << ", skip blocks by " << describe_filter(access, access.filters[access.zone_filter]);
+        }
+    }
+    for (size_t f = 0; f < access.filters.size; ++f) {
+        cout << (f == 0 ? ", filter " : " AND ") << describe_filter(access, access.filters[f]);
+    }
+    cout << ", rows " << static_cast<size_t>(access.rows + 0.5) << ", cost " << static_cast<size_t>(access.cost + 0.5) << endl;
+}
+
+void explain_plan(const QueryPlan& plan) {
+    if (plan.inputs.size > 1) {
+        const AccessPlan& inner = plan.inputs[plan.inner];
+        const AccessPlan& outer = plan.inputs[1 - plan.inner];
+        if (plan.join == JOIN_HASH) {
+            cout << "Hash join: build " << inner.table->name << ", probe " << outer.table->name;
+        }
+        else {
+            cout << "Nested loop: outer " << outer.table->name << ", inner " << inner.table->name;
+        }
+        for (size_t k = 0; k < plan.keys.size; ++k) {
+            const JoinKey& key = plan.keys[k];
+            cout << (k == 0 ? " on " : " AND ")
+                << plan.inputs[0].table->name << "." << plan.inputs[0].table->columns[key.columns[0]] << " = "
+                << plan.inputs[1].table->name << "." << plan.inputs[1].table->columns[key.columns[1]];
+        }
+        cout << ", rows " << static_cast<size_t>(plan.rows + 0.5) << ", cost " << static_cast<size_t>(plan.cost + 0.5) << endl;
+    }
+    for (size_t i = 0; i < plan.inputs.size; ++i) {
+        explain_access(plan.inputs[i]);
+    }
+}
+
+void explain_select(const CustVector<string>& table_names, const string& condition) {
+    CustVector<Table*> inputs;
+    for (size_t i = 0; i < table_names.size && i < 2; ++i) {
+        Table* table = reinterpret_cast<Table*>(tables.get(table_names[i]));
+        if (!table) {
+            cout << "Table not found: " << table_names[i] << endl;
+            return;
+        }
+        inputs.push_back(table);
+    }
+    if (inputs.size == 0) {
+        cout << "No tables specified." << endl;
+        return;
+    }
+    QueryPlan plan;
+    if (plan_select(inputs, condition, plan)) {
+        explain_plan(plan);
+    }
+}
+
+void scan_input(const AccessPlan& access, const function<void(const CustVector<string>&)>& emit) {
+    Table& table = *access.table;
+    if (access.method == ACCESS_INDEX_LOOKUP) {
+        CustVector<size_t> positions;
+        index_lookup(table, access.filters[access.index_filter].value, positions);
+        RowCursor cursor(table);
+        for (size_t i = 0; i < positions.size; ++i) {
+            cursor.seek(positions[i]);
+            // Строка перепроверяется: таблица могла измениться после чтения индекса
+            if (cursor.next() && row_matches(cursor.row(), access.filters)) {
+                emit(cursor.row());
+            }
+        }
+        return;
+    }
+
+    RowCursor cursor(table);
+    if (access.zone_filter != string::npos) {
+        const Filter& filter = access.filters[access.zone_filter];
+        cursor.filter(filter.column, filter.op, filter.value);  // Блоки, где условие заведомо ложно, не читаются
+    }
+    while (cursor.next()) {
+        if (row_matches(cursor.row(), access.filters)) {
+            emit(cursor.row());
+        }
+    }
+}
+
+static bool keys_match(const QueryPlan& plan, const CustVector<string>& first_row, const CustVector<string>& second_row, size_t from) {
+    for (size_t k = from; k < plan.keys.size; ++k) {
+        size_t first_column = plan.keys[k].columns[0];
+        size_t second_column = plan.keys[k].columns[1];
+        if (first_column >= first_row.size || second_column >= second_row.size || first_row[first_column] != second_row[second_column]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void execute_join(const QueryPlan& plan, const function<void(const CustVector<string>&, const CustVector<string>&)>& emit) {
+    size_t inner = plan.inner;
+    size_t outer = 1 - inner;
+    ArenaScope scope;  // Хеш-таблица соединения живёт в арене до конца оператора
+
+    // Снимок внутренней таблицы держит её хранилище, даже если DELETE заменит его:
+    // строки в памяти не копируются, соединение ссылается на них прямо в блоках хранилища
+    AccessPlan inner_access = plan.inputs[inner];
+    inner_access.table->lock.lock();
+    Table inner_table(*inner_access.table);
+    inner_access.table->lock.unlock();
+    inner_access.table = &inner_table;
+
+    // Внутренняя таблица читается один раз, условия к ней уже применены.
+    // Массив указателей в арене; строки страничной таблицы живут только в буфере курсора и копируются
+    vector<const CustVector<string>*, ArenaAllocator<const CustVector<string>*>> inner_rows;
+    CustVector<CustVector<string>> paged_rows;
+    scan_input(inner_access, [&](const CustVector<string>& row) {
+        if (inner_table.paged) paged_rows.push_back(row);
+        else inner_rows.push_back(&row);
+    });
+    for (size_t i = 0; i < paged_rows.size; ++i) {
+        inner_rows.push_back(&paged_rows[i]);
+    }
+
+    // Строки передаются в порядке FROM независимо от того, какая таблица внешняя
+    auto emit_pair = [&](const CustVector<string>& outer_row, const CustVector<string>& inner_row) {
+        if (outer == 0) emit(outer_row, inner_row);
+        else emit(inner_row, outer_row);
+    };
+
+    if (plan.join == JOIN_HASH) {
+        size_t build_column = plan.keys[0].columns[inner];
+        size_t probe_column = plan.keys[0].columns[outer];
+        // Ключи ссылаются на значения строк без копирования, узлы берутся из арены
+        unordered_multimap<string_view, size_t, hash<string_view>, equal_to<string_view>, ArenaAllocator<pair<const string_view, size_t>>> hashed;
+        hashed.reserve(inner_rows.size());
+        for (size_t i = 0; i < inner_rows.size(); ++i) {
+            if (build_column < inner_rows[i]->size) {
+                hashed.emplace(string_view((*inner_rows[i])[build_column]), i);
+            }
+        }
+        scan_input(plan.inputs[outer], [&](const CustVector<string>& outer_row) {
+            if (probe_column >= outer_row.size) return;
+            auto range = hashed.equal_range(string_view(outer_row[probe_column]));
+            for (auto it = range.first; it != range.second; ++it) {
+                const CustVector<string>& inner_row = *inner_rows[it->second];
+                const CustVector<string>& first_row = outer == 0 ? outer_row : inner_row;
+                const CustVector<string>& second_row = outer == 0 ? inner_row : outer_row;
+                if (keys_match(plan, first_row, second_row, 1)) emit_pair(outer_row, inner_row);
+            }
+        });
+        return;
+    }
+
+    scan_input(plan.inputs[outer], [&](const CustVector<string>& outer_row) {
+        for (size_t i = 0; i < inner_rows.size(); ++i) {
+            const CustVector<string>& inner_row = *inner_rows[i];
+            const CustVector<string>& first_row = outer == 0 ? outer_row : inner_row;
+            const CustVector<string>& second_row = outer == 0 ? inner_row : outer_row;
+            if (keys_match(plan, first_row, second_row, 0)) emit_pair(outer_row, inner_row);
+        }
+    });
+}
+
+void analyze_table(const string& table_name) {
+    Table* table = reinterpret_cast<Table*>(tables.get(table_name));
+    if (!table) {
+        cout << "Table not found." << endl;
+        return;
+    }
+
+    shared_ptr<TableStats> stats = make_shared<TableStats>();
+    CustVector<HyperLogLog> distinct;
+    CustVector<CustVector<string>> samples;  // Выборка непустых значений каждого столбца для гистограмм
+    for (size_t c = 0; c < table->columns.size; ++c) {
+        stats->columns.push_back(ColumnStats());
+        distinct.push_back(HyperLogLog());
+        samples.push_back(CustVector<string>());
+    }
+
+    size_t stride = row_count(*table) / ANALYZE_SAMPLE + 1;
+    RowCursor cursor(*table);
+    size_t rows = 0;
+    for (; cursor.next(); ++rows) {
+        const CustVector<string>& row = cursor.row();
+        for (size_t c = 0; c < stats->columns.size; ++c) {
+            if (c >= row.size || row[c].empty()) {
+                ++stats->columns[c].nulls;
+                continue;
+            }
+            distinct[c].add(row[c]);
+            if (rows % stride == 0) samples[c].push_back(row[c]);
+        }
+    }
+    stats->rows = rows;
+
+    for (size_t c = 0; c < stats->columns.size; ++c) {
+        ColumnStats& column = stats->columns[c];
+        column.distinct = distinct[c].estimate();
+        CustVector<string>& sample = samples[c];
+        sort(sample.data, sample.data + sample.size, [](const string& a, const string& b) {
+            return compare_values(a, b) < 0;
+        });
+        for (size_t b = 0; sample.size > 0 && b <= HISTOGRAM_BUCKETS; ++b) {
+            column.bounds.push_back(sample[b * (sample.size - 1) / HISTOGRAM_BUCKETS]);
+        }
+    }
+
+    shared_ptr<KeyIndex> index;
+    {
+        lock_guard<mutex> guard(table->lock);
+        table->stats = stats;
+        if (!table->pk_index && primary_key_column(*table) != string::npos) {
+            table->pk_index = make_shared<KeyIndex>();
+        }
+        index = table->pk_index;
+    }
+    if (index) {
+        update_index(*table, *index);
+    }
+
+    cout << "Table analyzed: " << rows << " rows." << endl;
+    for (size_t c = 0; c < stats->columns.size; ++c) {
+        cout << "  " << table->columns[c] << ": distinct " << stats->columns[c].distinct << ", nulls " << stats->columns[c].nulls << endl;
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <string>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include "SUBBSAD.h"
+using namespace std;
+
+const size_t HISTOGRAM_BUCKETS = 32;  // Корзин в гистограмме столбца
+const size_t ANALYZE_SAMPLE = 32768;  // Строк в выборке ANALYZE для гистограмм
+
+// Статистика столбца, собранная ANALYZE. Пустая строка считается NULL.
+struct ColumnStats {
+    size_t nulls;
+    size_t distinct;  // Оценка HyperLogLog
+    CustVector<string> bounds;  // Границы равноглубинной гистограммы по выборке, по возрастанию
+
+    ColumnStats() : nulls(0), distinct(0) {}
+};
+
+struct TableStats {
+    size_t rows;  // Строк на момент ANALYZE, оценки масштабируются на текущее число строк
+    CustVector<ColumnStats> columns;
+
+    TableStats() : rows(0) {}
+};
+
+// Хеш-индекс по первичному ключу: значение -> номера строк.
+// Создаётся ANALYZE, новые строки добавляются перед поиском, DELETE сбрасывает индекс.
+class KeyIndex {
+public:
+    unordered_multimap<string, size_t> positions;
+    size_t indexed_rows;  // Сколько первых строк таблицы уже в индексе
+    mutex lock;
+
+    KeyIndex() : indexed_rows(0) {}
+
+    void reset();
+};
+
+// Условие на столбец одной таблицы: столбец op значение
+struct Filter {
+    size_t column;
+    string op;
+    string value;
+};
+
+// Равенство столбцов двух таблиц, columns[i] — столбец таблицы i
+struct JoinKey {
+    size_t columns[2];
+};
+
+enum AccessMethod {
+    ACCESS_FULL_SCAN,  // Скан с пропуском блоков по статистике
+    ACCESS_INDEX_LOOKUP  // Поиск по индексу первичного ключа
+};
+
+enum JoinMethod {
+    JOIN_NONE,
+    JOIN_NESTED_LOOP,  // Каждая строка внешней таблицы со всеми строками внутренней
+    JOIN_HASH  // Хеш по внутренней таблице, проход по внешней
+};
+
+// Чтение одной таблицы вместе с опущенными к ней условиями
+struct AccessPlan {
+    Table* table;
+    CustVector<Filter> filters;
+    AccessMethod method;
+    size_t zone_filter;  // Условие, по которому скан пропускает блоки, npos — без пропуска
+    size_t index_filter;  // Условие по первичному ключу для ACCESS_INDEX_LOOKUP
+    double rows;  // Оценка числа строк после условий
+    double cost;  // Оценка числа прочитанных строк
+
+    AccessPlan() : table(nullptr), method(ACCESS_FULL_SCAN), zone_filter(string::npos), index_filter(string::npos), rows(0), cost(0) {}
+};
+
+struct QueryPlan {
+    CustVector<AccessPlan> inputs;  // В порядке FROM
+    CustVector<JoinKey> keys;  // Условия соединения; хеш строится по первому, остальные проверяются после
+    JoinMethod join;
+    size_t inner;  // Таблица, которая читается в память: сторона построения хеша или внутренний цикл
+    double rows;
+    double cost;
+
+    QueryPlan() : join(JOIN_NONE), inner(1), rows(0), cost(0) {}
+};
+
+bool row_matches(const CustVector<string>& row, const CustVector<Filter>& filters);
+// Выбор способа чтения таблицы по её условиям: заполняет method, оценки и номера условий
+void plan_access(AccessPlan& access);
+// Позиции выбранных столбцов в строках первой и второй таблицы, npos — столбца в таблице нет
+void resolve_projection(const CustVector<string>& selected, const Table& first, const Table* second, CustVector<size_t>& first_positions, CustVector<size_t>& second_positions);
+
+// Собирает статистику таблицы и строит индекс по первичному ключу
+void analyze_table(const string& table_name);
+// Разбор условия "столбец op значение [AND ...]" и выбор плана. false, если условие неверно
+bool plan_select(const CustVector<Table*>& inputs, const string& condition, QueryPlan& plan);
+void explain_plan(const QueryPlan& plan);
+void explain_select(const CustVector<string>& table_names, const string& condition);
+void scan_input(const AccessPlan& access, const function<void(const CustVector<string>&)>& emit);
+void execute_join(const QueryPlan& plan, const function<void(const CustVector<string>&, const CustVector<string>&)>& emit);
+
+#endif
@@ -0,0 +1,154 @@
+#include "ResultCache.h"
+#include <sstream>
+
+using namespace std;
+
+ResultCache result_cache;
+
+ResultCache::ResultCache(size_t limit)
+    : head(nullptr), tail(nullptr), used(0), limit(limit), hits(0), misses(0), evictions(0), invalidations(0) {}
+
+ResultCache::~ResultCache() {
+    clear();
+}
+
+void ResultCache::unlink(Entry* entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else tail = entry->prev;
+    entry->prev = nullptr;
+    entry->next = nullptr;
+}
+
+void ResultCache::push_front(Entry* entry) {
+    entry->prev = nullptr;
+    entry->next = head;
+    if (head) head->prev = entry;
+    head = entry;
+    if (!tail) tail = entry;
+}
+
+void ResultCache::erase(Entry* entry) {
+    unlink(entry);
+    entries.erase(entry->key);
+    used -= entry->bytes;
+    entry_pool.destroy(entry);
+}
+
+// Вытеснение самых давно использованных записей, пока занято больше bytes
+void ResultCache::evict_to(size_t bytes) {
+    while (used > bytes && tail) {
+        erase(tail);
+        ++evictions;
+    }
+}
+
+bool ResultCache::get(const string& key, const CustVector<unsigned long long>& versions, string& result) {
+    lock_guard<mutex> guard(cache_lock);
+    if (limit == 0) {
+        return false;
+    }
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        ++misses;
+        return false;
+    }
+    Entry* entry = it->second;
+    bool valid = entry->versions.size == versions.size;
+    for (size_t i = 0; valid && i < versions.size; ++i) {
+        valid = entry->versions[i] == versions[i];
+    }
+    if (!valid) {
+        erase(entry);  // Таблица изменилась после выполнения запроса
+        ++invalidations;
+        ++misses;
+        return false;
+    }
+    unlink(entry);
+    push_front(entry);
+    result = entry->result;
+    ++hits;
+    return true;
+}
+
+void ResultCache::put(const string& key, const CustVector<unsigned long long>& versions, const string& result) {
+    lock_guard<mutex> guard(cache_lock);
+    size_t bytes = key.size() + result.size() + versions.size * sizeof(unsigned long long) + CACHE_ENTRY_OVERHEAD;
+    if (limit == 0 || bytes > limit / 4) {
+        return;
+    }
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        erase(it->second);
+    }
+    evict_to(limit - bytes);
+
+    Entry* entry = entry_pool.create();
+    entry->key = key;
+    entry->versions = versions;
+    entry->result = result;
+    entry->bytes = bytes;
+    entry->prev = nullptr;
+    entry->next = nullptr;
+    push_front(entry);
+    entries[key] = entry;
+    used += bytes;
+}
+
+void ResultCache::setLimit(size_t bytes) {
+    lock_guard<mutex> guard(cache_lock);
+    limit = bytes;
+    evict_to(limit);
+}
+
+size_t ResultCache::maxResultSize() {
+    lock_guard<mutex> guard(cache_lock);
+    return limit / 4;
+}
+
+void ResultCache::clear() {
+    lock_guard<mutex> guard(cache_lock);
+    while (tail) {
+        erase(tail);
+    }
+}
+
+unsigned long long ResultCache::getHits() {
+    lock_guard<mutex> guard(cache_lock);
+    return hits;
+}
+
+unsigned long long ResultCache::getMisses() {
+    lock_guard<mutex> guard(cache_lock);
+    return misses;
+}
+
+void ResultCache::printStats() {
+    lock_guard<mutex> guard(cache_lock);
+    cout << "Result cache: hits " << hits << ", misses " << misses << ", entries " << entries.size()
+        << ", memory " << used << " of " << limit << " bytes, evictions " << evictions
+        << ", invalidations " << invalidations << endl;
+}
+
+string normalize_query(const CustVector<string>& table_names, const CustVector<string>& columns, const string& condition) {
+    string key;
+    for (size_t i = 0; i < table_names.size; ++i) {
+        key += (i > 0 ? "," : "") + table_names[i];
+    }
+    key += '\x1f';
+    for (size_t i = 0; i < columns.size; ++i) {
+        key += (i > 0 ? "," : "") + columns[i];
+    }
+    key += '\x1f';
+
+    // Условие по словам: запросы, отличающиеся только пробелами, дают один ключ
+    istringstream iss(condition);
+    string word;
+    bool first = true;
+    while (iss >> word) {
+        key += (first ? "" : " ") + word;
+        first = false;
+    }
+    return key;
+}
@@ -0,0 +1,63 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include "SUBBSAD.h"
+#include "Allocator.h"
+using namespace std;
+
+const size_t DEFAULT_CACHE_LIMIT = 64 * 1024 * 1024;  // Лимит памяти кеша результатов по умолчанию
+const size_t CACHE_ENTRY_OVERHEAD = 128;  // Учитываемый расход на служебные поля записи
+
+// Кеш результатов SELECT. Ключ — нормализованный запрос, запись действительна,
+// пока версии прочитанных таблиц не изменились. Вытеснение по давности использования (LRU).
+class ResultCache {
+private:
+    struct Entry {
+        string key;
+        CustVector<unsigned long long> versions;  // Версии таблиц запроса на момент выполнения
+        string result;
+        size_t bytes;
+        Entry* prev;  // Более недавно использованная запись
+        Entry* next;
+    };
+
+    unordered_map<string, Entry*> entries;
+    NodePool<Entry> entry_pool;
+    Entry* head;  // Самая недавно использованная
+    Entry* tail;  // Первая на вытеснение
+    size_t used;  // Учтённый объём памяти всех записей
+    size_t limit;  // 0 — кеш выключен
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    unsigned long long invalidations;  // Записи, отброшенные из-за изменения таблиц
+    mutex cache_lock;
+
+    void unlink(Entry* entry);
+    void push_front(Entry* entry);
+    void erase(Entry* entry);
+    void evict_to(size_t bytes);
+
+public:
+    ResultCache(size_t limit = DEFAULT_CACHE_LIMIT);
+    ~ResultCache();
+
+    bool get(const string& key, const CustVector<unsigned long long>& versions, string& result);
+    void put(const string& key, const CustVector<unsigned long long>& versions, const string& result);
+    void setLimit(size_t bytes);
+    size_t maxResultSize();  // Результаты длиннее не кешируются, чтобы одна запись не вытесняла весь кеш
+    void clear();
+    unsigned long long getHits();
+    unsigned long long getMisses();
+    void printStats();
+};
+
+extern ResultCache result_cache;
+
+// Ключ кеша: таблицы, столбцы и условие без лишних пробелов
+string normalize_query(const CustVector<string>& table_names, const CustVector<string>& columns, const string& condition);
+
+#endif
@@ -5,97 +5,31 @@
 #include <mutex>
 #include <string>
 #include <regex>
-#include "HashTable.h"  
+#include <filesystem>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "SUBBSAD.h"
+#include "Persistence.h"
+#include "BufferPool.h"
+#include "Compression.h"
+#include "Planner.h"
+#include "MaterializedView.h"
+#include "ResultCache.h"
+#include "Script.h"
+#include "Allocator.h"
 #include "nlohmann/json.hpp"  
 
 using namespace std;
 using json = nlohmann::json;
 
-// Самописная структура для хранения вектора
-template<typename T>
-struct CustVector {
-    T* data;  // Указатель на данные
-    size_t size;  // Текущий размер вектора
-    size_t capacity;  // Вместимость вектора
-
-    CustVector() : data(nullptr), size(0), capacity(0) {}  // Конструктор по умолчанию
-
-    CustVector(const CustVector& other) {  // Конструктор копирования
-        size = other.size;
-        capacity = other.capacity;
-        data = new T[capacity];
-        for (size_t i = 0; i < size; ++i) {
-            data[i] = other.data[i];
-        }
-    }
-
-    CustVector& operator=(const CustVector& other) {  // Оператор присваивания
-        if (this != &other) {
-            delete[] data;
-            size = other.size;
-            capacity = other.capacity;
-            data = new T[capacity];
-            for (size_t i = 0; i < size; ++i) {
-                data[i] = other.data[i];
-            }
-        }
-        return *this;
-    }
-
-    ~CustVector() {  // Деструктор
-        delete[] data;
-    }
-
-    void push_back(const T& value) {  // Добавление элемента в конец вектора
-        if (size == capacity) {
-            capacity = capacity == 0 ? 1 : capacity * 2;
-            T* new_data = new T[capacity];
-            for (size_t i = 0; i < size; ++i) {
-                new_data[i] = data[i];
-            }
-            delete[] data;
-            data = new_data;
-        }
-        data[size++] = value;
-    }
-
-    T& operator[](size_t index) {  // Оператор доступа по индексу
-        return data[index];
-    }
-
-    const T& operator[](size_t index) const {  // Константный оператор доступа по индексу
-        return data[index];
-    }
-};
-
-// Структуры для хранения таблицы
-struct Table {
-    string name;  // Имя таблицы
-    CustVector<string> columns;  // Столбцы таблицы
-    CustVector<CustVector<string>> rows;  // Строки таблицы
-    string primary_key;  // Первичный ключ
-    size_t pk_sequence;  // Последовательность для первичного ключа
-    mutex lock;  // Мьютекс для обеспечения потокобезопасности
-
-    Table(const string& n) : name(n), pk_sequence(0) {}  // Конструктор с именем таблицы
-
-    Table(const Table& other)  // Конструктор копирования
-        : name(other.name), columns(other.columns), rows(other.rows), primary_key(other.primary_key), pk_sequence(other.pk_sequence) {}
-
-    Table& operator=(const Table& other) {  // Оператор присваивания
-        if (this != &other) {
-            name = other.name;
-            columns = other.columns;
-            rows = other.rows;
-            primary_key = other.primary_key;
-            pk_sequence = other.pk_sequence;
-        }
-        return *this;
-    }
-};
-
 // Карта для хранения таблиц
 HashTable tables(10);  // Хеш-таблица для хранения таблиц
+atomic<unsigned long long> table_versions(0);
 
 string trim(const string& str) {
     size_t first = str.find_first_not_of(' ');
@@ -106,68 +40,211 @@ string trim(const string& str) {
     return str.substr(first, last - first + 1);
 }
 
-// Функция для сохранения данных в JSON
-void save_table_json(const Table& table) {
-    json j;
-    j["name"] = table.name;
-    j["columns"] = json::array();
+// Сброс файла или каталога на диск
+static bool sync_path(const string& path, bool directory) {
+#ifdef _WIN32
+    if (directory) return true;  // Каталог на Windows не открыть для сброса, переименование и так журналируется
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) return false;
+    bool synced = _commit(fd) == 0;
+    _close(fd);
+#else
+    int fd = open(path.c_str(), directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+    if (fd < 0) return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+#endif
+    return synced;
+}
+
+// Надёжная замена файла: временный файл сбрасывается на диск и переименовывается поверх path,
+// затем сбрасывается каталог. После сбоя на диске остаётся либо старый, либо новый файл целиком.
+bool replace_file(const string& temp_path, const string& path) {
+    error_code error;
+    if (!sync_path(temp_path, false)) {
+        cout << "Failed to sync " << temp_path << endl;
+        filesystem::remove(temp_path, error);
+        return false;
+    }
+    filesystem::rename(temp_path, path, error);  // В отличие от rename() заменяет существующий файл и на Windows
+    if (error) {
+        cout << "Failed to replace " << path << endl;
+        filesystem::remove(temp_path, error);
+        return false;
+    }
+    filesystem::path directory = filesystem::absolute(path).parent_path();
+    if (!sync_path(directory.string(), true)) {
+        cout << "Failed to sync directory of " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+// Функция для сохранения данных в JSON.
+// Строки пишутся потоком по одной, без построения всего документа в памяти.
+bool save_table_json(const Table& table) {
+    string file_name = table.name + ".json";
+    ofstream file(file_name + ".tmp");
+    if (!file.is_open()) {
+        cout << "Failed to open file for writing." << endl;
+        return false;
+    }
+    file << "{\n";
+    file << "    \"name\": " << json(table.name).dump() << ",\n";
+    file << "    \"columns\": [";
     for (size_t i = 0; i < table.columns.size; ++i) {
-        j["columns"].push_back(table.columns[i]);
+        file << (i > 0 ? ", " : "") << json(table.columns[i]).dump();
     }
-    j["rows"] = json::array();
-    for (size_t i = 0; i < table.rows.size; ++i) {
-        json row = json::array();
-        for (size_t j = 0; j < table.rows[i].size; ++j) {
-            row.push_back(table.rows[i][j]);
+    file << "],\n";
+    file << "    \"primary_key\": " << json(table.primary_key).dump() << ",\n";
+    file << "    \"rows\": [";
+    RowCursor cursor(table);
+    bool first_row = true;
+    while (cursor.next()) {
+        const CustVector<string>& row = cursor.row();
+        file << (first_row ? "\n        [" : ",\n        [");
+        for (size_t j = 0; j < row.size; ++j) {
+            file << (j > 0 ? ", " : "") << json(row[j]).dump();
         }
-        j["rows"].push_back(row);
+        file << "]";
+        first_row = false;
     }
-    j["primary_key"] = table.primary_key;
-
-    ofstream file(table.name + ".json");
-    file << j.dump(4);  // Сохранение JSON в файл с отступами для читаемости
+    file << (first_row ? "]\n" : "\n    ]\n");
+    file << "}";
+    file.close();
+    if (!file) {
+        cout << "Failed to write " << file_name << endl;
+        error_code error;
+        filesystem::remove(file_name + ".tmp", error);
+        return false;
+    }
+    return replace_file(file_name + ".tmp", file_name);
 }
 
+// Потоковый разбор JSON таблицы: строки сразу попадают в хранилище таблицы,
+// поэтому таблица может быть больше, чем помещается в памяти
+class TableJsonReader : public nlohmann::json_sax<json> {
+private:
+    Table& table;
+    std::string current_key;  // Текущий ключ верхнего уровня
+    int depth;  // Вложенность массивов
+    CustVector<std::string> row;
+
+    bool value(const std::string& val) {
+        if (depth == 0 && current_key == "name") table.name = val;
+        if (depth == 0 && current_key == "primary_key") table.primary_key = val;
+        if (depth == 1 && current_key == "columns") table.columns.push_back(val);
+        if (depth == 2 && current_key == "rows") row.push_back(val);
+        return true;
+    }
+
+public:
+    TableJsonReader(Table& table) : table(table), depth(0) {}
+
+    bool null() override { return true; }
+    bool boolean(bool val) override { return value(val ? "true" : "false"); }
+    bool number_integer(number_integer_t val) override { return value(to_string(val)); }
+    bool number_unsigned(number_unsigned_t val) override { return value(to_string(val)); }
+    bool number_float(number_float_t, const string_t& val) override { return value(val); }
+    bool string(string_t& val) override { return value(val); }
+    bool binary(binary_t&) override { return true; }
+    bool start_object(size_t) override { return true; }
+    bool end_object() override { return true; }
+    bool key(string_t& val) override {
+        if (depth == 0) current_key = val;
+        return true;
+    }
+    bool start_array(size_t) override {
+        ++depth;
+        if (depth == 2 && current_key == "rows") row.size = 0;
+        return true;
+    }
+    bool end_array() override {
+        // Строка, не поместившаяся в хранилище, прерывает разбор: неполная таблица не регистрируется
+        if (depth == 2 && current_key == "rows" && !append_row(table, row)) return false;
+        --depth;
+        return true;
+    }
+    bool parse_error(size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+        cout << "Invalid JSON: " << ex.what() << endl;
+        return false;
+    }
+};
+
 // Функция для загрузки данных из JSON
-void load_table_json(const string& table_name) {
+bool load_table_json(const string& table_name) {
     ifstream file(table_name + ".json");
     if (!file.is_open()) {
         cout << "File not found." << endl;
-        return;
+        return false;
     }
-    json j;
-    file >> j;
 
-    Table table(j["name"]);
-    for (const auto& col : j["columns"]) {
-        table.columns.push_back(col);
+    Table table(table_name);
+    init_storage(table);
+    TableJsonReader reader(table);
+    if (!json::sax_parse(file, &reader)) {
+        cout << "Table " << table_name << " not loaded." << endl;
+        return false;
     }
-    for (const auto& row : j["rows"]) {
-        CustVector<string> row_data;
-        for (const auto& val : row) {
-            row_data.push_back(val);
-        }
-        table.rows.push_back(row_data);
+    load_pk_sequence(table);
+    recover_pk_sequence(table);
+
+    bump_version(table);  // Результаты, закешированные для прежней копии таблицы, не подойдут
+    tables.put(table_name, reinterpret_cast<void*>(new Table(table)));  // Добавление таблицы в хеш-таблицу
+    return true;
+}
+
+// Загрузка таблицы из основного хранилища: сжатого <name>.tbl, а если его нет — из JSON
+bool load_table(const string& table_name) {
+    if (!filesystem::exists(table_name + ".tbl")) {
+        return load_table_json(table_name);
     }
-    table.primary_key = j["primary_key"];
 
+    Table table(table_name);
+    init_storage(table);
+    if (!load_table_compressed(table_name, table)) {
+        cout << "Table " << table_name << " not loaded." << endl;
+        return false;
+    }
+    load_pk_sequence(table);
+    recover_pk_sequence(table);
+
+    bump_version(table);  // Результаты, закешированные для прежней копии таблицы, не подойдут
     tables.put(table_name, reinterpret_cast<void*>(new Table(table)));  // Добавление таблицы в хеш-таблицу
+    return true;
+}
+
+// Сохранение таблицы в основное хранилище, возвращает имя записанного файла или пустую строку при ошибке.
+// Файл заменяется целиком только после сброса на диск, поэтому подтверждённая запись переживает сбой.
+string save_table(const Table& table) {
+    error_code error;
+    if (compress_tables && save_table_compressed(table)) {
+        filesystem::remove(table.name + ".json", error);  // Иначе при загрузке можно прочитать устаревшую копию
+        return table.name + ".tbl";
+    }
+    if (!save_table_json(table)) {
+        return "";
+    }
+    filesystem::remove(table.name + ".tbl", error);
+    return table.name + ".json";
 }
 
 // Загрузка таблицы из CSV
-void load_table_csv(const string& table_name) {
+bool load_table_csv(const string& table_name) {
     string file_path = table_name + ".csv";
     cout << "Trying to open file: " << file_path << endl;
 
     ifstream file(file_path);
     if (!file.is_open()) {
         cout << "File not found." << endl;
-        return;
+        return false;
     }
 
     Table table(table_name);
+    init_storage(table);
     string line;
     bool first_line = true;
+    size_t row_id = 0;
 
     while (getline(file, line)) {
         istringstream iss(line);
@@ -189,18 +266,25 @@ void load_table_csv(const string& table_name) {
         }
         else {
             // Остальные строки содержат данные
-            table.rows.push_back(row);
+            row[0] = to_string(row_id++);  // Обновляем ID
+            if (!append_row(table, row)) {
+                cout << "Table " << table_name << " not loaded." << endl;  // Неполная таблица не регистрируется
+                return false;
+            }
         }
     }
+    load_pk_sequence(table);
+    recover_pk_sequence(table);
 
-    // Обновление ID для каждой записи
-    for (size_t i = 0; i < table.rows.size; ++i) {
-        table.rows[i][0] = to_string(i);  // Обновляем ID
-    }
-
+    bump_version(table);  // Результаты, закешированные для прежней копии таблицы, не подойдут
     tables.put(table_name, reinterpret_cast<void*>(new Table(table)));  // Добавление таблицы в хеш-таблицу
-    save_table_json(table);  // Сохранение таблицы в JSON
-    cout << "Table loaded from " << table_name << ".csv and saved to " << table_name << ".json" << endl;
+    string saved_to = save_table(table);  // Сохранение таблицы на диск
+    if (saved_to.empty()) {
+        cout << "Table loaded from " << table_name << ".csv but not saved." << endl;
+        return true;  // Таблица зарегистрирована, запись повторит следующий INSERT или DELETE
+    }
+    cout << "Table loaded from " << table_name << ".csv and saved to " << saved_to << endl;
+    return true;
 }
 
 // Функция для сохранения таблицы в CSV
@@ -221,10 +305,12 @@ void save_table_csv(const Table& table) {
     file << endl;
 
     // Запись данных строк
-    for (size_t i = 0; i < table.rows.size; ++i) {
-        for (size_t j = 0; j < table.rows[i].size; ++j) {
-            file << "\"" << table.rows[i][j] << "\"";
-            if (j < table.rows[i].size - 1) {
+    RowCursor cursor(table);
+    while (cursor.next()) {
+        const CustVector<string>& row = cursor.row();
+        for (size_t j = 0; j < row.size; ++j) {
+            file << "\"" << row[j] << "\"";
+            if (j < row.size - 1) {
                 file << ",";
             }
         }
@@ -234,15 +320,30 @@ void save_table_csv(const Table& table) {
     cout << "Table saved to " << table.name << ".csv" << endl;
 }
 
-// Функция для сохранения последовательности первичных ключей
-void save_pk_sequence(const Table& table) {
-    ofstream file(table.name + "_pk_sequence.txt");
-    if (!file.is_open()) {
-        cout << "Failed to open file for writing pk_sequence." << endl;
-        return;
+// Функция для сохранения последовательности первичных ключей: boundary — граница зарезервированного блока.
+// false, если граница не записана на диск.
+bool save_pk_sequence(const string& table_name, size_t boundary) {
+    // Пишем во временный файл и заменяем, чтобы сбой посреди записи не испортил границу блока
+    string file_name = table_name + "_pk_sequence.txt";
+    {
+        ofstream file(file_name + ".tmp");
+        if (!file.is_open()) {
+            cout << "Failed to open file for writing pk_sequence." << endl;
+            return false;
+        }
+        file << boundary;
+        file.close();
+        if (!file) {
+            cout << "Failed to write pk_sequence file." << endl;
+            return false;
+        }
     }
-    file << table.pk_sequence;
-    cout << "Primary key sequence saved to " << table.name << "_pk_sequence.txt" << endl;
+    if (!replace_file(file_name + ".tmp", file_name)) {
+        cout << "Failed to replace pk_sequence file." << endl;
+        return false;
+    }
+    cout << "Primary key sequence saved to " << table_name << "_pk_sequence.txt" << endl;
+    return true;
 }
 
 // Функция для загрузки последовательности первичных ключей
@@ -252,10 +353,70 @@ void load_pk_sequence(Table& table) {
         cout << "File not found for pk_sequence." << endl;
         return;
     }
-    file >> table.pk_sequence;
+    size_t reserved = 0;
+    file >> reserved;
+    table.pk_reserved = reserved;
     cout << "Primary key sequence loaded from " << table.name << "_pk_sequence.txt" << endl;
 }
 
+// Выдача следующего первичного ключа без блокировки таблицы, 0 — новый блок не удалось зарезервировать.
+// Мьютекс берётся только раз в PK_BLOCK ключей, когда нужно сохранить новую границу блока.
+size_t next_pk(Table& table) {
+    size_t pk = table.pk_sequence.fetch_add(1) + 1;
+    if (pk > table.pk_reserved.load()) {
+        lock_guard<mutex> guard(table.pk_lock);
+        if (pk > table.pk_reserved.load()) {
+            size_t boundary = (pk / PK_BLOCK + 1) * PK_BLOCK;
+            if (!save_pk_sequence(table.name, boundary)) {
+                return 0;  // Ключ выдаётся только после того, как граница записана на диск
+            }
+            table.pk_reserved = boundary;
+        }
+    }
+    return pk;
+}
+
+// Восстановление последовательности после загрузки таблицы.
+// Ключи из последнего зарезервированного блока могли быть выданы до сбоя, поэтому продолжаем с его границы.
+// Наибольший ID берётся из статистики блоков: целые числа упорядочены по величине и идут раньше строк,
+// поэтому максимум из цифр — наибольший ключ блока. Таблица читается, только если статистики нет или она не помогает.
+static bool zones_max_pk(const Table& table, size_t& last_pk) {
+    size_t covered = 0;
+    for (size_t b = 0; b < table.zones.size; ++b) {
+        const ZoneBlock& block = table.zones[b];
+        covered += block.rows;
+        if (block.columns.size == 0 || block.columns[0].values == 0) continue;
+        const string& id = block.columns[0].max_value;
+        if (id.find_first_not_of("0123456789") != string::npos) return false;  // В блоке есть нечисловые ID
+        last_pk = max(last_pk, static_cast<size_t>(stoull(id)));
+    }
+    return covered == row_count(table);
+}
+
+void recover_pk_sequence(Table& table) {
+    size_t last_pk = table.pk_reserved;
+    if (zones_max_pk(table, last_pk)) {
+        table.pk_sequence = last_pk;
+        table.pk_reserved = last_pk;  // Следующая вставка зарезервирует новый блок
+        return;
+    }
+    last_pk = table.pk_reserved;
+    RowCursor cursor(table);
+    while (cursor.next()) {
+        const string& id = cursor.row()[0];
+        if (!id.empty() && id.find_first_not_of("0123456789") == string::npos) {
+            last_pk = max(last_pk, static_cast<size_t>(stoull(id)));
+        }
+    }
+    table.pk_sequence = last_pk;
+    table.pk_reserved = last_pk;  // Следующая вставка зарезервирует новый блок
+}
+
+// Новая версия таблицы: записи кеша результатов с прежней версией больше не совпадут
+void bump_version(Table& table) {
+    table.version = ++table_versions;
+}
+
 // Функция для сохранения состояния мьютекса
 void save_lock_state(const Table& table) {
     ofstream file(table.name + "_lock.txt");
@@ -290,6 +451,7 @@ void create_table(const string& table_name, const CustVector<string>& columns, c
     }
 
     Table new_table(table_name);
+    init_storage(new_table);
     new_table.columns.push_back(primary_key);  // Добавляем столбец для первичного ключа
     for (size_t i = 0; i < columns.size; ++i) {
         new_table.columns.push_back(columns[i]);
@@ -297,12 +459,33 @@ void create_table(const string& table_name, const CustVector<string>& columns, c
     new_table.primary_key = primary_key;
 
     tables.put(table_name, reinterpret_cast<void*>(new Table(new_table)));  // Добавление новой таблицы в хеш-таблицу
-    save_table_json(new_table);  // Сохранение таблицы в JSON
-    save_pk_sequence(new_table);  // Сохранение последовательности первичных ключей
+    save_table(new_table);  // Сохранение таблицы на диск
+    save_pk_sequence(new_table.name, new_table.pk_reserved);  // Сохранение последовательности первичных ключей
     save_lock_state(new_table);  // Сохранение состояния мьютекса
     cout << "Table created successfully." << endl;
 }
 
+// Строка для вставки: новый первичный ключ (без блокировки таблицы) и значения.
+// false, если ключ не выдан.
+static bool make_row(Table& table, const CustVector<string>& values, CustVector<string>& new_row) {
+    size_t pk = next_pk(table);
+    if (pk == 0) {
+        cout << "Failed to reserve primary key." << endl;
+        return false;
+    }
+    string pk_value = to_string(pk);
+
+    new_row.push_back(std::move(pk_value));  // Добавляем первичный ключ в начало строки
+    for (size_t i = 0; i < values.size; ++i) {
+        // Удаляем лишние символы
+        string value = values[i];
+        if (!value.empty() && value.front() == '(') value = value.substr(1);
+        if (!value.empty() && value.back() == ')') value = value.substr(0, value.size() - 1);
+        new_row.push_back(std::move(value));
+    }
+    return true;
+}
+
 // Функция для выполнения INSERT
 void insert_data(const string& table_name, const CustVector<string>& values) {
     Table* table = reinterpret_cast<Table*>(tables.get(table_name));
@@ -310,7 +493,11 @@ void insert_data(const string& table_name, const CustVector<string>& values) {
         cout << "Table not found." << endl;
         return;
     }
-    lock_guard<mutex> guard(table->lock);  // Блокировка мьютекса для потокобезопасности
+
+    if (is_materialized_view(table_name)) {
+        cout << "Cannot modify materialized view." << endl;
+        return;
+    }
 
     // Проверка на правильное количество значений
     if (values.size != table->columns.size - 1) {  // Уменьшаем на 1, так как первичный ключ добавляется автоматически
@@ -318,32 +505,84 @@ void insert_data(const string& table_name, const CustVector<string>& values) {
         return;
     }
 
-    // Генерация первичного ключа
-    size_t last_pk = 0;
-    if (table->rows.size > 0) {
-        // Находим последний первичный ключ
-        last_pk = stoi(table->rows[table->rows.size - 1][0]);
-    }
-    string pk_value = to_string(last_pk + 1);
-
     CustVector<string> new_row;
-    new_row.push_back(pk_value);  // Добавляем первичный ключ в начало строки
-    for (size_t i = 0; i < values.size; ++i) {
-        // Удаляем лишние символы
-        string value = values[i];
-        if (value.front() == '(') value = value.substr(1);
-        if (value.back() == ')') value = value.substr(0, value.size() - 1);
-        new_row.push_back(value);
+    if (!make_row(*table, values, new_row)) {
+        return;
     }
+    // Копия строки нужна только представлениям, сама строка переносится в таблицу
+    bool track_views = has_views(table_name);
+    CustVector<string> view_row;
+    if (track_views) view_row = new_row;
 
-    table->rows.push_back(new_row);
-    save_table_json(*table);  // Сохранение таблицы в JSON
-    save_pk_sequence(*table);  // Сохранение последовательности первичных ключей
+    unique_lock<mutex> guard(table->lock);  // Блокировка мьютекса для потокобезопасности
+    if (!append_row(*table, std::move(new_row))) {
+        return;
+    }
+    bump_version(*table);
+    guard.unlock();  // Под мьютексом только изменение в памяти, запись на диск ведёт фоновый поток
+    bool saved = persistence.submit(table);  // В памяти строка уже есть, запись на диск повторится позже
+    if (track_views) views_after_insert(table_name, view_row);
+    if (!saved) {
+        cout << "Data inserted but not saved to disk." << endl;
+        return;
+    }
     cout << "Data inserted successfully." << endl;
 }
 
+// Пакетный INSERT: все строки добавляются под одной блокировкой, таблица ставится в очередь сохранения один раз.
+// Строки с неверным числом значений пропускаются, остальные вставляются.
+void insert_batch(const string& table_name, const CustVector<CustVector<string>>& batch) {
+    Table* table = reinterpret_cast<Table*>(tables.get(table_name));
+    if (!table) {
+        cout << "Table not found." << endl;
+        return;
+    }
+
+    if (is_materialized_view(table_name)) {
+        cout << "Cannot modify materialized view." << endl;
+        return;
+    }
+
+    CustVector<CustVector<string>> new_rows;
+    for (size_t b = 0; b < batch.size; ++b) {
+        if (batch[b].size != table->columns.size - 1) {
+            cout << "Invalid number of values." << endl;
+            continue;
+        }
+        CustVector<string> new_row;
+        if (!make_row(*table, batch[b], new_row)) {
+            break;  // Следующие ключи тоже не выдать, пока граница не записывается
+        }
+        new_rows.push_back(std::move(new_row));
+    }
+
+    // Без представлений строки переносятся в таблицу, иначе копируются: они нужны после вставки
+    bool track_views = has_views(table_name);
+    size_t inserted = 0;
+    unique_lock<mutex> guard(table->lock);
+    while (inserted < new_rows.size && (track_views ? append_row(*table, new_rows[inserted]) : append_row(*table, std::move(new_rows[inserted])))) {
+        ++inserted;
+    }
+    if (inserted > 0) {
+        bump_version(*table);
+    }
+    guard.unlock();
+    if (inserted == 0) {
+        return;
+    }
+    bool saved = persistence.submit(table);
+    for (size_t i = 0; track_views && i < inserted; ++i) {
+        views_after_insert(table_name, new_rows[i]);
+    }
+    if (!saved) {
+        cout << inserted << " rows inserted but not saved to disk." << endl;
+        return;
+    }
+    cout << inserted << " rows inserted successfully." << endl;
+}
+
 // Функция для выполнения SELECT
-void select_data(const CustVector<string>& table_names, const CustVector<string>& columns, const string& condition = "") {
+void select_data(const CustVector<string>& table_names, const CustVector<string>& columns, const string& condition) {
     if (table_names.size == 0) {
         cout << "No tables specified." << endl;
         return;
@@ -385,95 +624,86 @@ void select_data(const CustVector<string>& table_names, const CustVector<string>
         }
     }
 
-    // Вывод данных
-    for (size_t i = 0; i < first_table->rows.size; ++i) {
-        bool match = true;
-        if (!condition.empty()) {
-            // Разбор условия
-            istringstream iss(condition);
-            string col, op, val;
-            iss >> col >> op >> val;
-
-            // Удаление лишних символов из значения
-            if (val.front() == '(') val = val.substr(1);
-            if (val.back() == ')') val = val.substr(0, val.size() - 1);
-
-            for (size_t j = 0; j < first_table->columns.size; ++j) {
-                if (first_table->columns[j] == col) {
-                    if (op == "=" && first_table->rows[i][j] != val) match = false;
-                    if (op == "!=" && first_table->rows[i][j] == val) match = false;
-                    break;
-                }
-            }
-        }
-        if (match) {
-            for (size_t j = 0; j < selected_columns.size; ++j) {
-                for (size_t k = 0; k < first_table->columns.size; ++k) {
-                    if (first_table->columns[k] == selected_columns[j]) {
-                        cout << first_table->rows[i][k] << " ";
-                        break;
-                    }
-                }
-            }
-            cout << endl;
-        }
-    }
-
-    // Если есть вторая таблица, выполняем CROSS JOIN
+    // Вторая таблица для CROSS JOIN
+    CustVector<Table*> inputs;
+    inputs.push_back(first_table);
+    Table* second_table = nullptr;
     if (table_names.size > 1) {
-        Table* second_table = reinterpret_cast<Table*>(tables.get(table_names[1]));
+        second_table = reinterpret_cast<Table*>(tables.get(table_names[1]));
         if (!second_table) {
             cout << "Table not found: " << table_names[1] << endl;
             return;
         }
+        inputs.push_back(second_table);
+    }
+
+    // Повторный запрос к неизменившимся таблицам отдаётся из кеша без выполнения.
+    // Версии читаются до выполнения: изменение во время запроса сделает запись устаревшей.
+    string cache_key = normalize_query(table_names, columns, condition);
+    CustVector<unsigned long long> versions;
+    for (size_t i = 0; i < inputs.size; ++i) {
+        versions.push_back(inputs[i]->version.load());
+    }
+    string output;
+    if (result_cache.get(cache_key, versions, output)) {
+        cout << output;
+        return;
+    }
+
+    // Планировщик выбирает способ чтения таблиц и соединения, условия опускаются к таблицам
+    QueryPlan plan;
+    if (!plan_select(inputs, condition, plan)) {
+        return;
+    }
+
+    // Позиции выбранных столбцов в строках таблиц, npos — столбца в таблице нет
+    CustVector<size_t> first_positions;
+    CustVector<size_t> second_positions;
+    resolve_projection(selected_columns, *first_table, second_table, first_positions, second_positions);
+
+    // Результат копится в output для кеша; если он перерос лимит записи кеша, дальше выводится сразу
+    size_t max_cached = result_cache.maxResultSize();
+    bool cacheable = max_cached > 0;
+    auto finish_line = [&]() {
+        output += '\n';
+        if (output.size() > max_cached) {
+            cout << output;
+            output.clear();
+            cacheable = false;
+        }
+    };
 
-        for (size_t i = 0; i < first_table->rows.size; ++i) {
-            for (size_t j = 0; j < second_table->rows.size; ++j) {
-                bool match = true;
-                if (!condition.empty()) {
-                    // Разбор условия
-                    istringstream iss(condition);
-                    string col, op, val;
-                    iss >> col >> op >> val;
-
-                    // Удаление лишних символов из значения
-                    if (val.front() == '(') val = val.substr(1);
-                    if (val.back() == ')') val = val.substr(0, val.size() - 1);
-
-                    for (size_t k = 0; k < first_table->columns.size; ++k) {
-                        if (first_table->columns[k] == col) {
-                            if (op == "=" && first_table->rows[i][k] != val) match = false;
-                            if (op == "!=" && first_table->rows[i][k] == val) match = false;
-                            break;
-                        }
-                    }
-                    for (size_t k = 0; k < second_table->columns.size; ++k) {
-                        if (second_table->columns[k] == col) {
-                            if (op == "=" && second_table->rows[j][k] != val) match = false;
-                            if (op == "!=" && second_table->rows[j][k] == val) match = false;
-                            break;
-                        }
-                    }
+    // Вывод данных
+    scan_input(plan.inputs[0], [&](const CustVector<string>& first_row) {
+        for (size_t j = 0; j < selected_columns.size; ++j) {
+            if (first_positions[j] != string::npos) {
+                output += first_row[first_positions[j]];
+                output += ' ';
+            }
+        }
+        finish_line();
+    });
+
+    // Если есть вторая таблица, выполняем CROSS JOIN
+    if (second_table) {
+        execute_join(plan, [&](const CustVector<string>& first_row, const CustVector<string>& second_row) {
+            for (size_t k = 0; k < selected_columns.size; ++k) {
+                if (first_positions[k] != string::npos) {
+                    output += first_row[first_positions[k]];
+                    output += ' ';
                 }
-                if (match) {
-                    for (size_t k = 0; k < selected_columns.size; ++k) {
-                        for (size_t l = 0; l < first_table->columns.size; ++l) {
-                            if (first_table->columns[l] == selected_columns[k]) {
-                                cout << first_table->rows[i][l] << " ";
-                                break;
-                            }
-                        }
-                        for (size_t l = 0; l < second_table->columns.size; ++l) {
-                            if (second_table->columns[l] == selected_columns[k]) {
-                                cout << second_table->rows[j][l] << " ";
-                                break;
-                            }
-                        }
-                    }
-                    cout << endl;
+                if (second_positions[k] != string::npos) {
+                    output += second_row[second_positions[k]];
+                    output += ' ';
                 }
             }
-        }
+            finish_line();
+        });
+    }
+
+    cout << output;
+    if (cacheable) {
+        result_cache.put(cache_key, versions, output);
     }
 }
 
@@ -483,10 +713,14 @@ void delete_data(const string& table_name, const string& condition) {
         cout << "Table not found." << endl;
         return;
     }
-    lock_guard<mutex> guard(table->lock);  // Блокировка мьютекса для потокобезопасности
+    if (is_materialized_view(table_name)) {
+        cout << "Cannot modify materialized view." << endl;
+        return;
+    }
+    unique_lock<mutex> guard(table->lock);  // Блокировка мьютекса для потокобезопасности
 
     // Проверка на пустую таблицу
-    if (table->rows.size == 0) {
+    if (row_count(*table) == 0) {
         cout << "Table is empty. Nothing to delete." << endl;
         return;
     }
@@ -511,23 +745,52 @@ void delete_data(const string& table_name, const string& condition) {
     // Отладочный вывод
     cout << "Parsed condition: col=" << col << ", op=" << op << ", val=" << val << endl;
 
-    CustVector<CustVector<string>> new_rows;
-    bool any_match = false;
+    size_t condition_column = string::npos;
+    for (size_t j = 0; j < table->columns.size; ++j) {
+        if (table->columns[j] == col) {
+            condition_column = j;
+            break;
+        }
+    }
 
-    for (size_t i = 0; i < table->rows.size; ++i) {
-        bool match = false;
-        for (size_t j = 0; j < table->columns.size; ++j) {
-            if (table->columns[j] == col) {
-                if (op == "=" && table->rows[i][j] == val) match = true;
-                if (op == "!=" && !(table->rows[i][j] == val)) match = true;
-                break;
-            }
+    // По статистике блоков проверяем, может ли условие выполниться хоть где-то
+    bool may_match = condition_column != string::npos && table->zones.size == 0;
+    for (size_t b = 0; condition_column != string::npos && b < table->zones.size && !may_match; ++b) {
+        may_match = zone_may_match(table->zones[b], condition_column, op, val);
+    }
+    if (!may_match) {
+        cout << "No rows matched the condition. Nothing to delete." << endl;
+        return;
+    }
+
+    // Оставшиеся строки пишутся в новое хранилище того же вида, что и у таблицы
+    Table survivors(table->name);
+    if (table->paged) {
+        survivors.paged = make_shared<PagedRows>(table->name);
+    }
+    bool any_match = false;
+    bool block_may_match = true;
+    CustVector<CustVector<string>> deleted;  // Удалённые строки для обновления представлений
+    bool track_deleted = has_views(table_name);
+
+    RowCursor cursor(*table);
+    for (size_t i = 0; cursor.next(); ++i) {
+        const CustVector<string>& row = cursor.row();
+        if (i % ZONE_ROWS == 0) {
+            // Строки блока, где условие заведомо ложно, переносятся без проверки
+            size_t block = i / ZONE_ROWS;
+            block_may_match = block >= table->zones.size || zone_may_match(table->zones[block], condition_column, op, val);
         }
+        bool match = block_may_match && condition_column < row.size && match_condition(row[condition_column], op, val);
         if (!match) {
-            new_rows.push_back(table->rows[i]);
+            // Переподвес ID
+            CustVector<string> kept = row;
+            kept[0] = to_string(row_count(survivors));  // Обновляем ID
+            append_row(survivors, kept);
         }
         else {
             any_match = true;
+            if (track_deleted) deleted.push_back(row);
         }
     }
 
@@ -536,23 +799,32 @@ void delete_data(const string& table_name, const string& condition) {
         return;
     }
 
-    // Переподвес ID
-    for (size_t i = 0; i < new_rows.size; ++i) {
-        new_rows[i][0] = to_string(i);  // Обновляем ID
+    table->rows = survivors.rows;
+    table->paged = survivors.paged;
+    table->visible_rows = survivors.visible_rows;
+    table->zones = survivors.zones;
+    if (table->pk_index) {
+        table->pk_index->reset();  // Номера строк изменились, индекс перестроится при следующем поиске
+    }
+    bump_version(*table);
+    guard.unlock();  // Под мьютексом только изменение в памяти, запись на диск ведёт фоновый поток
+    bool saved = persistence.submit(table);
+    if (track_deleted) {
+        views_after_delete(table_name, deleted);
+    }
+    if (!saved) {
+        cout << "Rows deleted but not saved to disk." << endl;
+        return;
     }
-
-    table->rows = new_rows;
-    save_table_json(*table);  // Сохранение таблицы в JSON
-    save_pk_sequence(*table);  // Сохранение последовательности первичных ключей
     cout << "Rows deleted successfully." << endl;
 }
 
 // Функция для создания таблиц на основе JSON-схемы
-void create_tables_from_schema(const string& schema_file) {
+bool create_tables_from_schema(const string& schema_file) {
     ifstream file(schema_file);
     if (!file.is_open()) {
         cout << "Schema file not found." << endl;
-        return;
+        return true;
     }
     json j;
     file >> j;
@@ -565,16 +837,29 @@ void create_tables_from_schema(const string& schema_file) {
         }
         string primary_key = table_json["primary_key"];
 
+        // Таблица уже сохранена на диске: загружаем её, а не затираем пустой
+        if (filesystem::exists(table_name + ".tbl") || filesystem::exists(table_name + ".json")) {
+            if (!load_table(table_name)) {
+                // Пустая таблица вместо неё затёрла бы файл при первой записи
+                cout << "Failed to load table " << table_name << " from disk." << endl;
+                return false;
+            }
+            cout << "Table " << table_name << " loaded from disk." << endl;
+            continue;
+        }
+
         Table new_table(table_name);
+        init_storage(new_table);
         new_table.columns = columns;
         new_table.primary_key = primary_key;
 
         tables.put(table_name, reinterpret_cast<void*>(new Table(new_table)));  // Добавление новой таблицы в хеш-таблицу
-        save_table_json(new_table);  // Сохранение таблицы в JSON
-        save_pk_sequence(new_table);  // Сохранение последовательности первичных ключей
+        save_table(new_table);  // Сохранение таблицы на диск
+        save_pk_sequence(new_table.name, new_table.pk_reserved);  // Сохранение последовательности первичных ключей
         save_lock_state(new_table);  // Сохранение состояния мьютекса
         cout << "Table " << table_name << " created successfully." << endl;
     }
+    return true;
 }
 
 // Функция для парсинга команд
@@ -614,109 +899,264 @@ CustVector<string> parse_command(const string& command) {
     return tokens;
 }
 
-int main() {
-    // Создание таблиц на основе JSON-схемы
-    create_tables_from_schema("schema.json");
+// Разбор INSERT INTO table_name VALUES (...): значения из списка в скобках
+bool parse_insert(const CustVector<string>& tokens, CustVector<string>& values) {
+    if (tokens.size < 5 || tokens[0] != "INSERT" || tokens[1] != "INTO" || tokens[3] != "VALUES") {
+        return false;
+    }
+    string values_str = tokens[4];
+    istringstream iss(values_str);
+    string value;
+    while (getline(iss, value, ',')) {
+        values.push_back(trim(value));
+    }
+    return true;
+}
 
-    string temp_command;
-    string command;
-    while (true) {
-        cout << "Enter command: ";
-        getline(cin, temp_command);
-        command = temp_command;
-        CustVector<string> tokens = parse_command(command);
-        if (tokens.size == 0) continue;
-
-        if (tokens[0] == "SELECT") {
-            if (tokens.size < 4 || tokens[2] != "FROM") {
-                cout << "Invalid SELECT command. Usage: SELECT ('column1', 'column2') FROM table_name1, table_name2" << endl;
-                continue;
-            }
-            CustVector<string> columns;
-            string columns_str = tokens[1];
-            istringstream iss_columns(columns_str);
-            string column;
-            while (getline(iss_columns, column, ',')) {
-                columns.push_back(trim(column));
-            }
-            CustVector<string> table_names;
-            string table_names_str = tokens[3];
-            istringstream iss_tables(table_names_str);
-            string table_name;
-            while (getline(iss_tables, table_name, ',')) {
-                table_names.push_back(trim(table_name));
-            }
-            string condition = "";
-            if (tokens.size > 4 && tokens[4] == "WHERE") {
-                condition = tokens[5];
-            }
+// Разбор SELECT, начиная с токена first: столбцы, таблицы и условие WHERE
+static bool parse_select(const CustVector<string>& tokens, size_t first, CustVector<string>& columns, CustVector<string>& table_names, string& condition) {
+    if (tokens.size < first + 4 || tokens[first] != "SELECT" || tokens[first + 2] != "FROM") {
+        return false;
+    }
+    string columns_str = tokens[first + 1];
+    istringstream iss_columns(columns_str);
+    string column;
+    while (getline(iss_columns, column, ',')) {
+        columns.push_back(trim(column));
+    }
+    string table_names_str = tokens[first + 3];
+    istringstream iss_tables(table_names_str);
+    string table_name;
+    while (getline(iss_tables, table_name, ',')) {
+        table_names.push_back(trim(table_name));
+    }
+    condition = "";
+    if (tokens.size > first + 4 && tokens[first + 4] == "WHERE") {
+        for (size_t i = first + 5; i < tokens.size; ++i) {
+            condition += (i > first + 5 ? " " : "") + tokens[i];
+        }
+    }
+    return true;
+}
+
+// Выполнение одной команды, false — команда EXIT
+bool execute_command(const string& command) {
+    return execute_command(command, parse_command(command));
+}
+
+static bool run_command(const string& command, const CustVector<string>& parsed) {
+    CustVector<string> tokens = parsed;
+    if (tokens.size == 0) return true;
+
+    // EXPLAIN SELECT ... печатает план запроса вместо результата
+    bool explain = false;
+    if (tokens[0] == "EXPLAIN" && tokens.size > 1) {
+        explain = true;
+        tokens = parse_command(command.substr(command.find("EXPLAIN") + 7));
+        if (tokens.size == 0 || tokens[0] != "SELECT") {
+            cout << "Invalid EXPLAIN command. Usage: EXPLAIN SELECT ..." << endl;
+            return true;
+        }
+    }
+
+    if (tokens[0] == "SELECT") {
+        CustVector<string> columns;
+        CustVector<string> table_names;
+        string condition;
+        if (!parse_select(tokens, 0, columns, table_names, condition)) {
+            cout << "Invalid SELECT command. Usage: SELECT ('column1', 'column2') FROM table_name1, table_name2" << endl;
+            return true;
+        }
+        if (explain) {
+            explain_select(table_names, condition);
+        }
+        else {
             select_data(table_names, columns, condition);
         }
-        else if (tokens[0] == "INSERT") {
-            if (tokens.size < 4 || tokens[1] != "INTO" || tokens[3] != "VALUES") {
-                cout << "Invalid INSERT command. Usage: INSERT INTO table_name VALUES (value1, value2)" << endl;
-                continue;
-            }
-            CustVector<string> values;
-            string values_str = tokens[4];
-            istringstream iss(values_str);
-            string value;
-            while (getline(iss, value, ',')) {
-                values.push_back(trim(value));
-            }
-            insert_data(tokens[2], values);
+    }
+    else if (tokens[0] == "ANALYZE") {
+        if (tokens.size != 2) {
+            cout << "Invalid ANALYZE command. Usage: ANALYZE table_name" << endl;
+            return true;
         }
-        else if (tokens[0] == "DELETE") {
-            if (tokens.size < 4 || tokens[1] != "FROM" || tokens[3] != "WHERE") {
-                cout << "Invalid DELETE command. Usage: DELETE FROM table_name WHERE column = value" << endl;
-                continue;
-            }
-            delete_data(tokens[2], tokens[4]);
+        analyze_table(tokens[1]);
+    }
+    else if (tokens[0] == "INSERT") {
+        CustVector<string> values;
+        if (!parse_insert(tokens, values)) {
+            cout << "Invalid INSERT command. Usage: INSERT INTO table_name VALUES (value1, value2)" << endl;
+            return true;
         }
-        else if (tokens[0] == "LOAD") {
-            if (tokens.size == 3 && tokens[1] == "TABLE") {
-                load_table_json(tokens[2]);
-            }
-            else if (tokens.size == 3 && tokens[1] == "CSV") {
-                load_table_csv(tokens[2]);
-            }
-            else {
-                cout << "Invalid LOAD command. Usage: LOAD TABLE table_name or LOAD CSV table_name" << endl;
-            }
+        insert_data(tokens[2], values);
+    }
+    else if (tokens[0] == "DELETE") {
+        if (tokens.size < 5 || tokens[1] != "FROM" || tokens[3] != "WHERE") {
+            cout << "Invalid DELETE command. Usage: DELETE FROM table_name WHERE column = value" << endl;
+            return true;
         }
-        else if (tokens[0] == "CREATE") {
-            if (tokens.size < 6 || tokens[1] != "TABLE" || tokens[3] != "(" || tokens[tokens.size - 2] != ")") {
-                cout << "Invalid CREATE TABLE command. Usage: CREATE TABLE table_name (column1, column2) PRIMARY KEY (primary_key)" << endl;
-                continue;
-            }
-            CustVector<string> columns;
-            string columns_str = tokens[3];
-            istringstream iss(columns_str);
-            string column;
-            while (getline(iss, column, ',')) {
-                columns.push_back(trim(column));
-            }
-            create_table(tokens[2], columns, tokens[tokens.size - 1]);
+        string condition = tokens[4];
+        for (size_t i = 5; i < tokens.size; ++i) {
+            condition += " " + tokens[i];
         }
-        else if (tokens[0] == "SAVE") {
-            if (tokens.size != 3 || tokens[1] != "TABLE") {
-                cout << "Invalid SAVE command. Usage: SAVE TABLE table_name" << endl;
-                continue;
-            }
-            Table* table = reinterpret_cast<Table*>(tables.get(tokens[2]));
-            if (!table) {
-                cout << "Table not found." << endl;
-                continue;
+        delete_data(tokens[2], condition);
+    }
+    else if (tokens[0] == "LOAD") {
+        // Отложенные и стоящие в очереди изменения записываются до чтения файла: иначе фоновый поток
+        // позже сохранит прежнюю копию таблицы поверх загруженной
+        if (!persistence.checkpoint()) {
+            cout << "Pending changes could not be saved to disk. LOAD cancelled." << endl;
+        }
+        else if (tokens.size == 3 && tokens[1] == "TABLE") {
+            if (load_table(tokens[2])) {
+                load_view_definition(tokens[2]);  // Таблица может быть материализованным представлением
             }
-            save_table_csv(*table);
         }
-        else if (tokens[0] == "EXIT") {
-            break;
+        else if (tokens.size == 3 && tokens[1] == "CSV") {
+            load_table_csv(tokens[2]);
         }
         else {
-            cout << "Unknown command." << endl;
+            cout << "Invalid LOAD command. Usage: LOAD TABLE table_name or LOAD CSV table_name" << endl;
+        }
+    }
+    else if (tokens[0] == "CREATE" && tokens.size > 2 && tokens[1] == "MATERIALIZED" && tokens[2] == "VIEW") {
+        CustVector<string> columns;
+        CustVector<string> table_names;
+        string condition;
+        if (tokens.size < 5 || tokens[4] != "AS" || !parse_select(tokens, 5, columns, table_names, condition)) {
+            cout << "Invalid CREATE MATERIALIZED VIEW command. Usage: CREATE MATERIALIZED VIEW view_name AS SELECT ..." << endl;
+            return true;
         }
+        create_materialized_view(tokens[3], table_names, columns, condition);
+    }
+    else if (tokens[0] == "REFRESH") {
+        if (tokens.size != 4 || tokens[1] != "MATERIALIZED" || tokens[2] != "VIEW") {
+            cout << "Invalid REFRESH command. Usage: REFRESH MATERIALIZED VIEW view_name" << endl;
+            return true;
+        }
+        refresh_materialized_view(tokens[3]);
+    }
+    else if (tokens[0] == "CREATE") {
+        if (tokens.size < 6 || tokens[1] != "TABLE" || tokens[3] != "(" || tokens[tokens.size - 2] != ")") {
+            cout << "Invalid CREATE TABLE command. Usage: CREATE TABLE table_name (column1, column2) PRIMARY KEY (primary_key)" << endl;
+            return true;
+        }
+        CustVector<string> columns;
+        string columns_str = tokens[3];
+        istringstream iss(columns_str);
+        string column;
+        while (getline(iss, column, ',')) {
+            columns.push_back(trim(column));
+        }
+        create_table(tokens[2], columns, tokens[tokens.size - 1]);
+    }
+    else if (tokens[0] == "SAVE") {
+        if (tokens.size != 3 || tokens[1] != "TABLE") {
+            cout << "Invalid SAVE command. Usage: SAVE TABLE table_name" << endl;
+            return true;
+        }
+        Table* table = reinterpret_cast<Table*>(tables.get(tokens[2]));
+        if (!table) {
+            cout << "Table not found." << endl;
+            return true;
+        }
+        save_table_csv(*table);
+    }
+    else if (tokens[0] == "SET") {
+        if (tokens.size == 3 && tokens[1] == "DURABILITY" && (tokens[2] == "SYNC" || tokens[2] == "ASYNC")) {
+            persistence.setDurability(tokens[2] == "SYNC" ? Durability::Sync : Durability::Async);
+            cout << "Durability set to " << tokens[2] << "." << endl;
+        }
+        else if (tokens.size == 3 && tokens[1] == "COMPRESSION" && (tokens[2] == "ON" || tokens[2] == "OFF")) {
+            compress_tables = tokens[2] == "ON";
+            cout << "Compression " << (compress_tables ? "enabled" : "disabled") << "." << endl;
+        }
+        else if (tokens.size == 3 && tokens[1] == "MEMORY_LIMIT" && !tokens[2].empty() && tokens[2].find_first_not_of("0123456789") == string::npos) {
+            persistence.flush();  // Фоновый поток не должен держать страницы, пока пул перестраивается
+            buffer_pool.setMemoryBudget(stoull(tokens[2]) * 1024 * 1024);
+            cout << "Memory limit set to " << tokens[2] << " MB." << endl;
+        }
+        else if (tokens.size == 3 && tokens[1] == "CACHE_LIMIT" && !tokens[2].empty() && tokens[2].find_first_not_of("0123456789") == string::npos) {
+            result_cache.setLimit(stoull(tokens[2]) * 1024 * 1024);
+            cout << "Result cache limit set to " << tokens[2] << " MB." << endl;
+        }
+        else {
+            cout << "Invalid SET command. Usage: SET DURABILITY SYNC|ASYNC, SET COMPRESSION ON|OFF, SET MEMORY_LIMIT megabytes or SET CACHE_LIMIT megabytes" << endl;
+        }
+    }
+    else if (tokens[0] == "STATS") {
+        result_cache.printStats();
+        print_allocation_stats();
+    }
+    else if (tokens[0] == "FLUSH" || tokens[0] == "CHECKPOINT") {
+        if (persistence.checkpoint()) {
+            cout << "All changes flushed to disk." << endl;
+        }
+        else {
+            cout << "Some changes could not be saved to disk." << endl;
+        }
+    }
+    else if (tokens[0] == "EXIT") {
+        persistence.stop();  // Дописываем очередь сохранения перед выходом
+        return false;
+    }
+    else {
+        cout << "Unknown command." << endl;
+    }
+    return true;
+}
+
+// Оператор выполняется в своей области арены: временные данные освобождаются по его окончании
+bool execute_command(const string& command, const CustVector<string>& parsed) {
+    unsigned long long before = allocation_count();
+    bool result;
+    {
+        ArenaScope scope;
+        result = run_command(command, parsed);
+    }
+    record_statements(1, allocation_count() - before);
+    return result;
+}
+
+#ifndef SUBBSAD_NO_MAIN
+int main(int argc, char* argv[]) {
+    // SUBBSAD [--memory-limit МБ] [script.sql | -]
+    string script;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--memory-limit" && i + 1 < argc && string(argv[i + 1]).find_first_not_of("0123456789") == string::npos) {
+            // Лимит задаётся до загрузки таблиц схемы, иначе они целиком окажутся в памяти
+            buffer_pool.setMemoryBudget(stoull(argv[++i]) * 1024 * 1024);
+        }
+        else if (script.empty() && arg.compare(0, 2, "--") != 0) {
+            script = arg;
+        }
+        else {
+            cout << "Usage: SUBBSAD [--memory-limit megabytes] [script.sql | -]" << endl;
+            return 1;
+        }
+    }
+
+    // Создание таблиц на основе JSON-схемы
+    if (!create_tables_from_schema("schema.json")) {
+        return 1;
+    }
+    load_view_definitions();  // Представления сопровождаются с первого изменения базовых таблиц
+
+    // Пакетный режим: SUBBSAD script.sql или SUBBSAD - для скрипта со стандартного ввода
+    if (!script.empty()) {
+        return run_script(script) ? 0 : 1;
+    }
+
+    string command;
+    while (true) {
+        cout << "Enter command: ";
+        if (!getline(cin, command)) {
+            persistence.stop();  // Ввод закончился без EXIT
+            break;
+        }
+        if (!execute_command(command)) break;
     }
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
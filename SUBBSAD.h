@@ -0,0 +1,97 @@
+#ifndef SUBBSAD_H
+#define SUBBSAD_H
+
+#include <iostream>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include "HashTable.h"
+#include "CustVector.h"
+#include "ZoneMap.h"
+using namespace std;
+
+class MemoryRows;  // Строки таблицы в памяти (BufferPool.h)
+class PagedRows;  // Страничное хранилище строк (BufferPool.h)
+struct TableStats;  // Статистика ANALYZE (Planner.h)
+class KeyIndex;  // Индекс по первичному ключу (Planner.h)
+
+// Источник номеров версий таблиц, общий для всех таблиц: номера не повторяются,
+// даже если таблицу загрузили заново под тем же именем
+extern atomic<unsigned long long> table_versions;
+
+// Размер блока первичных ключей, резервируемого на диске за одну запись
+const size_t PK_BLOCK = 1000;
+
+// Структуры для хранения таблицы
+struct Table {
+    string name;  // Имя таблицы
+    CustVector<string> columns;  // Столбцы таблицы
+    shared_ptr<MemoryRows> rows;  // Строки таблицы, общие для всех копий таблицы
+    shared_ptr<PagedRows> paged;  // Строки на диске вместо rows, если задан лимит памяти
+    size_t visible_rows;  // Число строк хранилища, видимых этой копии таблицы
+    CustVector<ZoneBlock> zones;  // Min/max и прочая статистика по блокам строк для пропуска при сканах
+    shared_ptr<TableStats> stats;  // Статистика для планировщика, собирается ANALYZE
+    shared_ptr<KeyIndex> pk_index;  // Хеш-индекс по первичному ключу, создаётся ANALYZE
+    string primary_key;  // Первичный ключ
+    atomic<size_t> pk_sequence;  // Последний выданный первичный ключ
+    atomic<size_t> pk_reserved;  // Граница блока ключей, сохранённая на диске
+    atomic<unsigned long long> version;  // Меняется при каждом изменении строк, по ней проверяется кеш результатов
+    mutex pk_lock;  // Мьютекс для резервирования нового блока ключей
+    mutex lock;  // Мьютекс для обеспечения потокобезопасности
+
+    Table(const string& n) : name(n), visible_rows(0), pk_sequence(0), pk_reserved(0), version(++table_versions) {}  // Конструктор с именем таблицы
+
+    Table(const Table& other)  // Конструктор копирования: строки не копируются, хранилище общее
+        : name(other.name), columns(other.columns), rows(other.rows), paged(other.paged), visible_rows(other.visible_rows), zones(other.zones), stats(other.stats), pk_index(other.pk_index), primary_key(other.primary_key),
+        pk_sequence(other.pk_sequence.load()), pk_reserved(other.pk_reserved.load()), version(other.version.load()) {}
+
+    Table& operator=(const Table& other) {  // Оператор присваивания
+        if (this != &other) {
+            name = other.name;
+            columns = other.columns;
+            rows = other.rows;
+            paged = other.paged;
+            visible_rows = other.visible_rows;
+            zones = other.zones;
+            stats = other.stats;
+            pk_index = other.pk_index;
+            primary_key = other.primary_key;
+            pk_sequence = other.pk_sequence.load();
+            pk_reserved = other.pk_reserved.load();
+            version = other.version.load();
+        }
+        return *this;
+    }
+};
+
+// Карта для хранения таблиц
+extern HashTable tables;
+
+string trim(const string& str);
+bool save_table_json(const Table& table);
+bool load_table_json(const string& table_name);  // false — таблица не загружена и не зарегистрирована
+bool load_table(const string& table_name);
+string save_table(const Table& table);
+bool replace_file(const string& temp_path, const string& path);  // Сброс temp_path на диск и атомарная замена path
+bool load_table_csv(const string& table_name);
+void save_table_csv(const Table& table);
+bool save_pk_sequence(const string& table_name, size_t boundary);
+void load_pk_sequence(Table& table);
+size_t next_pk(Table& table);  // 0 — ключ не выдан
+void recover_pk_sequence(Table& table);
+void bump_version(Table& table);  // Новая версия после изменения строк таблицы
+void save_lock_state(const Table& table);
+void load_lock_state(Table& table);
+void create_table(const string& table_name, const CustVector<string>& columns, const string& primary_key);
+void insert_data(const string& table_name, const CustVector<string>& values);
+void insert_batch(const string& table_name, const CustVector<CustVector<string>>& batch);
+void select_data(const CustVector<string>& table_names, const CustVector<string>& columns, const string& condition = "");
+void delete_data(const string& table_name, const string& condition);
+bool create_tables_from_schema(const string& schema_file);  // false, если сохранённую таблицу схемы не удалось загрузить
+CustVector<string> parse_command(const string& command);
+bool parse_insert(const CustVector<string>& tokens, CustVector<string>& values);
+bool execute_command(const string& command);  // false — команда EXIT
+bool execute_command(const string& command, const CustVector<string>& tokens);  // Команда, уже разобранная parse_command
+
+#endif
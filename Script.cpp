@@ -0,0 +1,159 @@
+#include "Script.h"
+#include "Persistence.h"
+#include "Allocator.h"
+#include <fstream>
+#include <thread>
+#include <condition_variable>
+
+using namespace std;
+
+// Разобранный оператор скрипта
+struct Statement {
+    string text;
+    CustVector<string> tokens;
+    CustVector<string> values;  // Значения INSERT
+    bool insert;
+
+    Statement() : insert(false) {}
+};
+
+// Очередь разобранных операторов между потоком чтения и исполнителем.
+// Общая для обоих потоков: поток чтения может пережить исполнителя, если скрипт закончился EXIT,
+// а стандартный ввод ещё открыт.
+struct ScriptState {
+    ifstream file;
+    istream* in;
+    Statement* queue;  // Кольцевой буфер на SCRIPT_QUEUE операторов
+    size_t head;
+    size_t count;
+    bool finished;  // Поток чтения дошёл до конца ввода
+    bool stopped;  // Исполнитель больше не ждёт операторов
+    mutex queue_lock;
+    condition_variable not_empty;
+    condition_variable not_full;
+
+    ScriptState() : in(nullptr), head(0), count(0), finished(false), stopped(false) {
+        queue = new Statement[SCRIPT_QUEUE];
+    }
+
+    ~ScriptState() {
+        delete[] queue;
+    }
+};
+
+// false для пустых строк и комментариев "--"
+static bool parse_statement(string line, Statement& statement) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ';' || line.back() == ' ')) {
+        line.pop_back();
+    }
+    line = trim(line);
+    if (line.empty() || line.compare(0, 2, "--") == 0) {
+        return false;
+    }
+    statement.text = line;
+    statement.tokens = parse_command(line);
+    statement.values = CustVector<string>();
+    statement.insert = parse_insert(statement.tokens, statement.values);
+    return statement.tokens.size > 0;
+}
+
+static void read_script(shared_ptr<ScriptState> state) {
+    string line;
+    Statement statement;
+    while (getline(*state->in, line)) {
+        if (!parse_statement(line, statement)) continue;
+
+        unique_lock<mutex> guard(state->queue_lock);
+        state->not_full.wait(guard, [&state] { return state->count < SCRIPT_QUEUE || state->stopped; });
+        if (state->stopped) return;
+        state->queue[(state->head + state->count) % SCRIPT_QUEUE] = statement;
+        ++state->count;
+        state->not_empty.notify_one();
+    }
+    lock_guard<mutex> guard(state->queue_lock);
+    state->finished = true;
+    state->not_empty.notify_one();
+}
+
+static bool next_statement(ScriptState& state, Statement& statement) {
+    unique_lock<mutex> guard(state.queue_lock);
+    state.not_empty.wait(guard, [&state] { return state.count > 0 || state.finished; });
+    if (state.count == 0) {
+        return false;
+    }
+    statement = state.queue[state.head];
+    state.head = (state.head + 1) % SCRIPT_QUEUE;
+    --state.count;
+    state.not_full.notify_one();
+    return true;
+}
+
+// Пакет INSERT выполняется одним вызовом, выделения памяти делятся на все его операторы
+static void flush_batch(const string& table_name, CustVector<CustVector<string>>& batch) {
+    unsigned long long before = allocation_count();
+    insert_batch(table_name, batch);
+    record_statements(batch.size, allocation_count() - before);
+    batch = CustVector<CustVector<string>>();
+}
+
+bool run_script(const string& path) {
+    shared_ptr<ScriptState> state = make_shared<ScriptState>();
+    if (path == "-") {
+        state->in = &cin;
+    }
+    else {
+        state->file.open(path);
+        if (!state->file.is_open()) {
+            cout << "Script file not found: " << path << endl;
+            return false;
+        }
+        state->in = &state->file;
+    }
+
+    thread reader(read_script, state);
+    persistence.setDeferred(true);
+
+    size_t statements = 0;
+    bool exited = false;
+    CustVector<CustVector<string>> batch;  // Значения подряд идущих INSERT в batch_table
+    string batch_table;
+    Statement statement;
+    while (next_statement(*state, statement)) {
+        ++statements;
+        bool same_table = statement.insert && statement.tokens[2] == batch_table;
+        if (batch.size > 0 && (!same_table || batch.size == SCRIPT_BATCH_ROWS)) {
+            flush_batch(batch_table, batch);
+        }
+        if (statement.insert) {
+            batch_table = statement.tokens[2];
+            batch.push_back(statement.values);
+            continue;
+        }
+        if (statement.tokens[0] == "EXIT") {
+            exited = true;
+            break;
+        }
+        execute_command(statement.text, statement.tokens);
+    }
+    if (batch.size > 0) {
+        flush_batch(batch_table, batch);
+    }
+    if (!persistence.setDeferred(false)) {  // Запись всех таблиц, изменённых скриптом
+        cout << "Some changes could not be saved to disk." << endl;
+    }
+
+    {
+        lock_guard<mutex> guard(state->queue_lock);
+        state->stopped = true;
+    }
+    state->not_full.notify_one();
+    if (exited) {
+        reader.detach();  // Поток может ждать стандартный ввод, который никто не закроет
+    }
+    else {
+        reader.join();
+    }
+    persistence.stop();
+    cout << "Script finished: " << statements << " statements." << endl;
+    return true;
+}
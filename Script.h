@@ -0,0 +1,17 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <string>
+#include "SUBBSAD.h"
+using namespace std;
+
+const size_t SCRIPT_QUEUE = 1024;  // Сколько операторов разбирается наперёд
+const size_t SCRIPT_BATCH_ROWS = 10000;  // Максимум строк в одном пакете INSERT
+
+// Выполнение SQL-скрипта по оператору в строке; "-" — стандартный ввод.
+// Операторы читаются и разбираются в отдельном потоке, пока выполняются предыдущие.
+// Подряд идущие INSERT в одну таблицу выполняются пакетом, а запись на диск
+// откладывается до CHECKPOINT (или FLUSH) и конца скрипта.
+bool run_script(const string& path);
+
+#endif
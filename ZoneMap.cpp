@@ -0,0 +1,151 @@
+#include "ZoneMap.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// Хеш, одинаковый на всех платформах: статистика сохраняется на диск
+static uint64_t stable_hash(const string& value) {
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a
+    for (unsigned char ch : value) {
+        hash ^= ch;
+        hash *= 1099511628211ull;
+    }
+    // Перемешивание младших бит, по которым выбирается регистр
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+HyperLogLog::HyperLogLog() {
+    memset(registers, 0, sizeof(registers));
+}
+
+void HyperLogLog::add(const string& value) {
+    uint64_t hash = stable_hash(value);
+    size_t index = hash % HLL_REGISTERS;
+    uint64_t rest = hash / HLL_REGISTERS;
+    unsigned char rank = 1;
+    while (rank < 59 && !(rest & 1)) {
+        ++rank;
+        rest >>= 1;
+    }
+    if (rank > registers[index]) registers[index] = rank;
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < HLL_REGISTERS; ++i) {
+        if (other.registers[i] > registers[i]) registers[i] = other.registers[i];
+    }
+}
+
+size_t HyperLogLog::estimate() const {
+    double sum = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < HLL_REGISTERS; ++i) {
+        sum += ldexp(1.0, -registers[i]);
+        if (registers[i] == 0) ++zeros;
+    }
+    double m = HLL_REGISTERS;
+    double estimate = 0.709 * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * log(m / zeros);  // Поправка для малых множеств
+    }
+    return static_cast<size_t>(estimate + 0.5);
+}
+
+static bool is_integer(const string& value) {
+    size_t start = !value.empty() && value[0] == '-' ? 1 : 0;
+    if (start == value.size()) return false;
+    return value.find_first_not_of("0123456789", start) == string::npos;
+}
+
+// Сравнение записей целых чисел любой длины без переполнения
+static int compare_integers(const string& a, const string& b) {
+    bool a_negative = a[0] == '-';
+    bool b_negative = b[0] == '-';
+    size_t a_start = a.find_first_not_of('0', a_negative ? 1 : 0);
+    size_t b_start = b.find_first_not_of('0', b_negative ? 1 : 0);
+    string a_digits = a_start == string::npos ? "" : a.substr(a_start);
+    string b_digits = b_start == string::npos ? "" : b.substr(b_start);
+    if (a_digits.empty()) a_negative = false;  // -0 равно 0
+    if (b_digits.empty()) b_negative = false;
+    if (a_negative != b_negative) return a_negative ? -1 : 1;
+
+    int result = 0;
+    if (a_digits.size() != b_digits.size()) {
+        result = a_digits.size() < b_digits.size() ? -1 : 1;
+    }
+    else {
+        int cmp = a_digits.compare(b_digits);
+        result = cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+    }
+    return a_negative ? -result : result;
+}
+
+int compare_values(const string& a, const string& b) {
+    bool a_integer = is_integer(a);
+    bool b_integer = is_integer(b);
+    if (a_integer != b_integer) return a_integer ? -1 : 1;
+    if (a_integer) {
+        int result = compare_integers(a, b);
+        if (result != 0) return result;
+    }
+    // Разные записи одного числа (007 и 7) различаются по строке, чтобы порядок совпадал с равенством
+    int cmp = a.compare(b);
+    return cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+}
+
+bool match_condition(const string& value, const string& op, const string& target) {
+    if (op == "=") return value == target;
+    if (op == "!=") return value != target;
+    if (op == "<") return compare_values(value, target) < 0;
+    if (op == "<=") return compare_values(value, target) <= 0;
+    if (op == ">") return compare_values(value, target) > 0;
+    if (op == ">=") return compare_values(value, target) >= 0;
+    return true;
+}
+
+void zone_add_row(CustVector<ZoneBlock>& zones, const CustVector<string>& row) {
+    if (zones.size == 0 || zones[zones.size - 1].rows == ZONE_ROWS) {
+        zones.push_back(ZoneBlock());
+    }
+    ZoneBlock& block = zones[zones.size - 1];
+    while (block.columns.size < row.size) {
+        ColumnZone column;
+        column.nulls = block.rows;  // У прежних строк блока этого значения не было
+        block.columns.push_back(column);
+    }
+    for (size_t i = 0; i < block.columns.size; ++i) {
+        ColumnZone& column = block.columns[i];
+        if (i >= row.size || row[i].empty()) {
+            ++column.nulls;
+            continue;
+        }
+        const string& value = row[i];
+        if (column.values == 0 || compare_values(value, column.min_value) < 0) column.min_value = value;
+        if (column.values == 0 || compare_values(value, column.max_value) > 0) column.max_value = value;
+        ++column.values;
+        column.distinct.add(value);
+    }
+    ++block.rows;
+}
+
+bool zone_may_match(const ZoneBlock& block, size_t column, const string& op, const string& target) {
+    if (column >= block.columns.size) return true;
+    const ColumnZone& zone = block.columns[column];
+    if (zone.nulls > 0 && match_condition("", op, target)) return true;
+    if (zone.values == 0) return false;
+
+    int low = compare_values(zone.min_value, target);
+    int high = compare_values(zone.max_value, target);
+    if (op == "=") return low <= 0 && high >= 0;
+    if (op == "!=") return !(low == 0 && high == 0);
+    if (op == "<") return low < 0;
+    if (op == "<=") return low <= 0;
+    if (op == ">") return high > 0;
+    if (op == ">=") return high >= 0;
+    return true;
+}
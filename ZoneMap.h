@@ -0,0 +1,50 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include <string>
+#include "CustVector.h"
+using namespace std;
+
+const size_t ZONE_ROWS = 65536;  // Строк в блоке статистики, совпадает с блоком сжатого файла
+const size_t HLL_REGISTERS = 64;
+
+// Оценка числа различных значений (HyperLogLog, погрешность около 13%)
+class HyperLogLog {
+public:
+    unsigned char registers[HLL_REGISTERS];
+
+    HyperLogLog();
+
+    void add(const string& value);
+    void merge(const HyperLogLog& other);
+    size_t estimate() const;
+};
+
+// Статистика столбца в одном блоке строк. Пустая строка считается NULL.
+struct ColumnZone {
+    string min_value;
+    string max_value;
+    size_t nulls;
+    size_t values;  // Непустых значений, min/max заданы только если values > 0
+    HyperLogLog distinct;
+
+    ColumnZone() : nulls(0), values(0) {}
+};
+
+struct ZoneBlock {
+    size_t rows;
+    CustVector<ColumnZone> columns;
+
+    ZoneBlock() : rows(0) {}
+};
+
+// Полный порядок значений: целые числа по величине, затем остальные строки лексикографически
+int compare_values(const string& a, const string& b);
+// Сравнение значения с условием WHERE; неизвестный оператор условию не мешает
+bool match_condition(const string& value, const string& op, const string& target);
+
+void zone_add_row(CustVector<ZoneBlock>& zones, const CustVector<string>& row);
+// false, если ни одна строка блока не может удовлетворить условию
+bool zone_may_match(const ZoneBlock& block, size_t column, const string& op, const string& target);
+
+#endif
@@ -0,0 +1,210 @@
+// Проверка сжатого формата .tbl: таблица сохраняется и читается обратно, строки и статистика блоков должны совпасть.
+// Данные подобраны под все кодировки столбца: PLAIN (уникальные строки), DICT_RLE (серии), DICT_PACKED (мало значений),
+// INT_FOR (узкий диапазон), INT_DELTA (возрастающие ID), а также отрицательные числа, ведущие нули, пустые значения,
+// 18–20-значные числа и ширины упаковки, при которых значения пересекают границу 64-битного слова.
+// Сборка (из корня репозитория): g++ -std=c++17 -O2 -DSUBBSAD_NO_MAIN -I. tests/compression_roundtrip.cpp SUBBSAD.cpp HashTable.cpp Persistence.cpp BufferPool.cpp Compression.cpp ZoneMap.cpp Planner.cpp MaterializedView.cpp ResultCache.cpp Allocator.cpp Script.cpp -pthread -o compression_roundtrip
+// Запуск: ./compression_roundtrip [--seed N] [--random-cases N]; код возврата 0 — все случаи прошли
+#include <iostream>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include "SUBBSAD.h"
+#include "BufferPool.h"
+#include "Compression.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+typedef function<string(size_t row, mt19937_64& random)> ColumnGenerator;
+
+struct GeneratorCase {
+    string name;
+    ColumnGenerator generate;
+};
+
+static string random_text(mt19937_64& random, size_t max_length) {
+    static const char alphabet[] = "abcXYZ019 ,;\"'\\/-_\x1f\xd0\xb0";
+    size_t length = random() % (max_length + 1);
+    string value;
+    for (size_t i = 0; i < length; ++i) {
+        value += alphabet[random() % (sizeof(alphabet) - 1)];
+    }
+    return value;
+}
+
+static CustVector<GeneratorCase> make_generators() {
+    CustVector<GeneratorCase> generators;
+    generators.push_back({ "id", [](size_t row, mt19937_64&) { return to_string(row); } });
+    generators.push_back({ "u_name", [](size_t row, mt19937_64&) { return "user" + to_string(row); } });
+    generators.push_back({ "u_mail", [](size_t row, mt19937_64&) { return "user" + to_string(row) + "@mail.ru"; } });
+    generators.push_back({ "gu_group", [](size_t row, mt19937_64&) { return "group" + to_string(row % 100); } });
+    generators.push_back({ "runs", [](size_t row, mt19937_64&) { return "state" + to_string(row / 1000 % 3); } });
+    generators.push_back({ "few_values", [](size_t, mt19937_64& random) { return "v" + to_string(random() % 5); } });
+    generators.push_back({ "narrow_ints", [](size_t, mt19937_64& random) { return to_string(1000 + random() % 64); } });
+    generators.push_back({ "negative_ints", [](size_t, mt19937_64& random) {
+        return to_string(static_cast<long long>(random() % 2000001) - 1000000);
+    } });
+    generators.push_back({ "leading_zeros", [](size_t, mt19937_64& random) {
+        static const char* values[] = { "0", "00", "007", "7", "0123", "-0", "-07", "10" };
+        return string(values[random() % 8]);
+    } });
+    generators.push_back({ "with_empty", [](size_t row, mt19937_64& random) {
+        return random() % 3 == 0 ? string() : to_string(row * 3);
+    } });
+    generators.push_back({ "all_empty", [](size_t, mt19937_64&) { return string(); } });
+    generators.push_back({ "digits_18", [](size_t, mt19937_64& random) {
+        return to_string(100000000000000000ULL + random() % 900000000000000000ULL);
+    } });
+    generators.push_back({ "digits_20", [](size_t, mt19937_64& random) {
+        static const char* values[] = { "0", "18446744073709551615", "9223372036854775807", "9223372036854775808", "1" };
+        return string(values[random() % 5]);
+    } });
+    generators.push_back({ "descending_wide", [](size_t row, mt19937_64&) {
+        return to_string(1000000000000000000ULL - row * 1000003ULL);
+    } });
+    generators.push_back({ "text", [](size_t, mt19937_64& random) { return random_text(random, 12); } });
+    // Случайная ширина значений от 1 до 63 бит: упакованные значения попадают на стык 64-битных слов
+    for (unsigned width = 1; width < 64; width += 6) {
+        generators.push_back({ "bits_" + to_string(width), [width](size_t, mt19937_64& random) {
+            return to_string(random() & ((1ULL << width) - 1));
+        } });
+    }
+    return generators;
+}
+
+static bool same_zone(const ColumnZone& a, const ColumnZone& b) {
+    return a.min_value == b.min_value && a.max_value == b.max_value && a.nulls == b.nulls && a.values == b.values
+        && memcmp(a.distinct.registers, b.distinct.registers, HLL_REGISTERS) == 0;
+}
+
+// Пустая строка, если таблицы совпадают, иначе описание первого расхождения
+static string compare_tables(const Table& expected, const Table& actual) {
+    if (expected.columns.size != actual.columns.size) return "column count";
+    for (size_t c = 0; c < expected.columns.size; ++c) {
+        if (expected.columns[c] != actual.columns[c]) return "column name " + to_string(c);
+    }
+    if (expected.primary_key != actual.primary_key) return "primary key";
+    if (row_count(expected) != row_count(actual)) return "row count " + to_string(row_count(actual));
+    RowCursor expected_cursor(expected);
+    RowCursor actual_cursor(actual);
+    for (size_t r = 0; expected_cursor.next(); ++r) {
+        if (!actual_cursor.next()) return "row " + to_string(r) + " missing";
+        const CustVector<string>& a = expected_cursor.row();
+        const CustVector<string>& b = actual_cursor.row();
+        if (a.size != b.size) return "row " + to_string(r) + " size";
+        for (size_t c = 0; c < a.size; ++c) {
+            if (a[c] != b[c]) return "row " + to_string(r) + " column " + to_string(c) + ": '" + a[c] + "' != '" + b[c] + "'";
+        }
+    }
+    if (expected.zones.size != actual.zones.size) return "zone count";
+    for (size_t b = 0; b < expected.zones.size; ++b) {
+        const ZoneBlock& a = expected.zones[b];
+        const ZoneBlock& z = actual.zones[b];
+        if (a.rows != z.rows || a.columns.size != z.columns.size) return "zone " + to_string(b) + " shape";
+        for (size_t c = 0; c < a.columns.size; ++c) {
+            if (!same_zone(a.columns[c], z.columns[c])) return "zone " + to_string(b) + " column " + to_string(c);
+        }
+    }
+    return "";
+}
+
+// Таблица из выбранных генераторов сохраняется в .tbl и загружается обратно
+static bool run_case(const string& label, const CustVector<GeneratorCase>& columns, size_t rows, mt19937_64& random) {
+    Table table("RT");
+    init_storage(table);
+    table.primary_key = "C0";
+    for (size_t c = 0; c < columns.size; ++c) {
+        table.columns.push_back("C" + to_string(c));
+    }
+    CustVector<string> row;
+    for (size_t r = 0; r < rows; ++r) {
+        row.size = 0;
+        for (size_t c = 0; c < columns.size; ++c) {
+            row.push_back(columns[c].generate(r, random));
+        }
+        append_row(table, row);
+    }
+
+    string error;
+    if (!save_table_compressed(table)) {
+        error = "save failed";
+    }
+    else {
+        Table loaded("RT");
+        init_storage(loaded);
+        if (!load_table_compressed("RT", loaded)) error = "load failed";
+        else error = compare_tables(table, loaded);
+    }
+    if (error.empty()) return true;
+
+    cerr << "FAIL " << label << " rows=" << rows << " columns=";
+    for (size_t c = 0; c < columns.size; ++c) {
+        cerr << (c > 0 ? "," : "") << columns[c].name;
+    }
+    cerr << ": " << error << endl;
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long long seed = 20240601;
+    size_t random_cases = 40;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--seed") seed = stoull(argv[i + 1]);
+        else if (arg == "--random-cases") random_cases = stoull(argv[i + 1]);
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
+    fs::path work_dir = fs::temp_directory_path() / ("subbsad_roundtrip_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(work_dir);
+    fs::current_path(work_dir);
+
+    NullBuffer null_buffer;
+    streambuf* console = cout.rdbuf();
+    cout.rdbuf(&null_buffer);
+
+    mt19937_64 random(seed);
+    CustVector<GeneratorCase> generators = make_generators();
+    size_t cases = 0;
+    size_t failures = 0;
+
+    // Каждый генератор отдельно на размерах вокруг границ блока
+    const size_t sizes[] = { 1, 2, 63, 64, 65, 1000, BLOCK_ROWS - 1, BLOCK_ROWS, BLOCK_ROWS + 1, 140000 };
+    for (size_t g = 0; g < generators.size; ++g) {
+        CustVector<GeneratorCase> columns;
+        columns.push_back(generators[0]);
+        columns.push_back(generators[g]);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            ++cases;
+            if (!run_case("single", columns, sizes[s], random)) ++failures;
+        }
+    }
+
+    // Случайные наборы столбцов и размеры, в том числе на несколько блоков
+    for (size_t i = 0; i < random_cases; ++i) {
+        CustVector<GeneratorCase> columns;
+        size_t column_count = 1 + random() % 6;
+        for (size_t c = 0; c < column_count; ++c) {
+            columns.push_back(generators[random() % generators.size]);
+        }
+        ++cases;
+        if (!run_case("random", columns, 1 + random() % 140000, random)) ++failures;
+    }
+
+    cout.rdbuf(console);
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(work_dir);
+
+    cout << cases - failures << " of " << cases << " cases passed (seed " << seed << ")." << endl;
+    return failures == 0 ? 0 : 1;
+}
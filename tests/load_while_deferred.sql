@@ -0,0 +1,9 @@
+-- LOAD TABLE посреди скрипта: запись на диск отложена, прежняя копия таблицы
+-- не должна затереть загруженную.
+-- Запуск в каталоге со schema.json без сохранённых таблиц:
+--   SUBBSAD tests/load_while_deferred.sql
+-- Ожидается, что последний SELECT и SELECT после перезапуска выводят обе строки: a и b.
+INSERT INTO U VALUES (a, a)
+LOAD TABLE U
+INSERT INTO U VALUES (b, b)
+SELECT * FROM U
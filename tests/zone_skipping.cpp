@@ -0,0 +1,222 @@
+// Проверка статистики блоков: пропуск блоков по зонам должен давать те же строки, что и полный перебор.
+// Для каждого условия (все операторы, значения из таблицы, границы, пустая строка, нечисловые и отрицательные)
+// проверяется, что zone_may_match не отбрасывает блок с подходящей строкой и что курсор с filter()
+// возвращает ровно строки полного перебора. После DELETE и INSERT статистика сверяется с пересчитанной заново.
+// Таблицы проверяются в памяти и в страницах, где пропуск блоков идёт по страницам.
+// Сборка (из корня репозитория): g++ -std=c++17 -O2 -DSUBBSAD_NO_MAIN -I. tests/zone_skipping.cpp SUBBSAD.cpp HashTable.cpp Persistence.cpp BufferPool.cpp Compression.cpp ZoneMap.cpp Planner.cpp MaterializedView.cpp ResultCache.cpp Allocator.cpp Script.cpp -pthread -o zone_skipping
+// Запуск: ./zone_skipping [--seed N]; код возврата 0 — все проверки прошли
+#include <iostream>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include "SUBBSAD.h"
+#include "BufferPool.h"
+#include "Persistence.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+static const size_t TABLE_ROWS = 2 * ZONE_ROWS + 1234;  // Два полных блока и неполный
+static const string OPERATORS[] = { "=", "!=", "<", "<=", ">", ">=" };
+
+static size_t failures = 0;
+static size_t checks = 0;
+
+static void check(bool ok, const string& what) {
+    ++checks;
+    if (!ok) {
+        ++failures;
+        cerr << "FAIL " << what << endl;
+    }
+}
+
+// Столбцы: ID по порядку, время по порядку с повторами, случайные числа, отрицательные с пустыми, строки, смесь
+static CustVector<string> make_row(size_t i, mt19937_64& random) {
+    CustVector<string> row;
+    row.push_back(to_string(i));
+    row.push_back(to_string(1700000000 + i / 7));
+    row.push_back(to_string(random() % 100000));
+    row.push_back(random() % 5 == 0 ? string() : to_string(static_cast<long long>(random() % 2001) - 1000));
+    row.push_back("name" + to_string(random() % 300));
+    row.push_back(random() % 2 ? to_string(random() % 50) : "x" + to_string(random() % 50));
+    return row;
+}
+
+static CustVector<string> make_targets(const Table& table, const CustVector<CustVector<string>>& rows, size_t column, mt19937_64& random) {
+    CustVector<string> targets;
+    const char* fixed[] = { "", "0", "-1", "-1000", "name150", "x25", "zzz" };
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); ++i) {
+        targets.push_back(fixed[i]);
+    }
+    for (size_t b = 0; b < table.zones.size; ++b) {
+        if (column < table.zones[b].columns.size && table.zones[b].columns[column].values > 0) {
+            targets.push_back(table.zones[b].columns[column].min_value);
+            targets.push_back(table.zones[b].columns[column].max_value);
+        }
+    }
+    for (size_t i = 0; i < 2 && rows.size > 0; ++i) {
+        targets.push_back(rows[random() % rows.size][column]);
+    }
+    return targets;
+}
+
+// rows — копия строк таблицы для полного перебора, чтобы не читать страницы на каждое условие
+static void check_target(const Table& table, const CustVector<CustVector<string>>& rows, size_t column, const string& target, const string& label) {
+    const size_t operators = sizeof(OPERATORS) / sizeof(OPERATORS[0]);
+    CustVector<size_t> expected[operators];  // Номера подходящих строк
+    CustVector<size_t> block_matches[operators];  // Подходящих строк в каждом блоке
+    for (size_t i = 0; i < rows.size; ++i) {
+        const CustVector<string>& row = rows[i];
+        for (size_t o = 0; o < operators; ++o) {
+            if (i % ZONE_ROWS == 0) block_matches[o].push_back(0);
+            if (column < row.size && match_condition(row[column], OPERATORS[o], target)) {
+                expected[o].push_back(i);
+                ++block_matches[o][block_matches[o].size - 1];
+            }
+        }
+    }
+
+    for (size_t o = 0; o < operators; ++o) {
+        string what = label + " column " + to_string(column) + " " + OPERATORS[o] + " '" + target + "'";
+        for (size_t b = 0; b < table.zones.size && b < block_matches[o].size; ++b) {
+            if (block_matches[o][b] > 0) {
+                check(zone_may_match(table.zones[b], column, OPERATORS[o], target), what + ": block " + to_string(b) + " skipped with matching rows");
+            }
+        }
+
+        // Строки сверяются по ID: он уникален и не меняется между перебором и сканом
+        size_t found = 0;
+        bool same = true;
+        RowCursor filtered(table);
+        filtered.filter(column, OPERATORS[o], target);
+        while (filtered.next()) {
+            const CustVector<string>& row = filtered.row();
+            if (column < row.size && match_condition(row[column], OPERATORS[o], target)) {
+                same = same && found < expected[o].size && row[0] == rows[expected[o][found]][0];
+                ++found;
+            }
+        }
+        check(same && found == expected[o].size, what + ": filtered scan returned " + to_string(found) + " rows, full scan " + to_string(expected[o].size));
+    }
+}
+
+static void check_all_predicates(const Table& table, mt19937_64& random, const string& label) {
+    CustVector<CustVector<string>> rows;
+    RowCursor cursor(table);
+    while (cursor.next()) {
+        rows.push_back(cursor.row());
+    }
+    for (size_t column = 0; column < table.columns.size; ++column) {
+        CustVector<string> targets = make_targets(table, rows, column, random);
+        for (size_t t = 0; t < targets.size; ++t) {
+            check_target(table, rows, column, targets[t], label);
+        }
+    }
+}
+
+// Статистика таблицы должна совпадать с посчитанной заново по её строкам
+static void check_zones_rebuilt(const Table& table, const string& label) {
+    CustVector<ZoneBlock> rebuilt;
+    RowCursor cursor(table);
+    while (cursor.next()) {
+        zone_add_row(rebuilt, cursor.row());
+    }
+    bool same = rebuilt.size == table.zones.size;
+    for (size_t b = 0; same && b < rebuilt.size; ++b) {
+        same = rebuilt[b].rows == table.zones[b].rows && rebuilt[b].columns.size == table.zones[b].columns.size;
+        for (size_t c = 0; same && c < rebuilt[b].columns.size; ++c) {
+            const ColumnZone& a = rebuilt[b].columns[c];
+            const ColumnZone& z = table.zones[b].columns[c];
+            same = a.min_value == z.min_value && a.max_value == z.max_value && a.nulls == z.nulls && a.values == z.values
+                && memcmp(a.distinct.registers, z.distinct.registers, HLL_REGISTERS) == 0;
+        }
+    }
+    check(same, label + ": zones differ from zones rebuilt from rows");
+}
+
+static void run_storage(const string& label, mt19937_64& random) {
+    Table* table = new Table("ZT");
+    init_storage(*table);
+    table->primary_key = "ID";
+    const char* names[] = { "ID", "TS", "N", "NEG", "NAME", "MIX" };
+    for (size_t c = 0; c < sizeof(names) / sizeof(names[0]); ++c) {
+        table->columns.push_back(names[c]);
+    }
+    for (size_t i = 0; i < TABLE_ROWS; ++i) {
+        append_row(*table, make_row(i, random));
+    }
+    table->pk_sequence = TABLE_ROWS;
+    tables.put("ZT", reinterpret_cast<void*>(table));
+
+    check_zones_rebuilt(*table, label + " after load");
+    check_all_predicates(*table, random, label);
+
+    // По упорядоченному ID условие на равенство оставляет один блок из всех
+    size_t candidates = 0;
+    for (size_t b = 0; b < table->zones.size; ++b) {
+        if (zone_may_match(table->zones[b], 0, "=", to_string(ZONE_ROWS + 5))) ++candidates;
+    }
+    check(candidates == 1, label + ": equality on ordered ID leaves " + to_string(candidates) + " blocks");
+
+    // DELETE перестраивает статистику, INSERT дополняет последний блок
+    delete_data("ZT", "N < 30000");
+    check_zones_rebuilt(*table, label + " after DELETE");
+    check_all_predicates(*table, random, label + " after DELETE");
+    CustVector<CustVector<string>> batch;
+    for (size_t i = 0; i < 1000; ++i) {
+        CustVector<string> row = make_row(i, random);
+        CustVector<string> values;
+        for (size_t c = 1; c < row.size; ++c) {
+            values.push_back(row[c]);
+        }
+        batch.push_back(values);
+    }
+    insert_batch("ZT", batch);
+    check_zones_rebuilt(*table, label + " after INSERT");
+    check_all_predicates(*table, random, label + " after INSERT");
+
+    persistence.flush();  // Фоновый поток не должен держать указатель на удаляемую таблицу
+    tables.remove("ZT");
+    persistence.forget(table);
+    delete table;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long long seed = 20240601;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--seed") seed = stoull(argv[i + 1]);
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
+    fs::path work_dir = fs::temp_directory_path() / ("subbsad_zones_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(work_dir);
+    fs::current_path(work_dir);
+
+    NullBuffer null_buffer;
+    streambuf* console = cout.rdbuf();
+    cout.rdbuf(&null_buffer);
+
+    mt19937_64 random(seed);
+    run_storage("memory", random);
+    buffer_pool.setMemoryBudget(2 * 1024 * 1024);  // Меньше таблицы: страницы вытесняются во время сканов
+    run_storage("paged", random);
+    buffer_pool.setMemoryBudget(0);
+    persistence.stop();
+
+    cout.rdbuf(console);
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(work_dir);
+
+    cout << checks - failures << " of " << checks << " checks passed (seed " << seed << ")." << endl;
+    return failures == 0 ? 0 : 1;
+}